@@ -0,0 +1,227 @@
+/*
+ * binary_result.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_BINARY_RESULT_HPP_
+#define SRC_BINARY_RESULT_HPP_
+
+#include <libpq-fe.h>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <osmium/osm/location.hpp>
+
+/**
+ * \brief Accessors for columns of query results which were requested in binary format.
+ *
+ * PostgreSQL sends all numbers in network byte order (big endian). Geometries are sent by PostGIS
+ * as EWKB whose byte order is given by the first byte of the geometry.
+ *
+ * The decode_* functions work on raw values and are independent from libpq, the get_* functions
+ * read a field of a query result. Parameters of prepared statements use the same representation,
+ * the encode_* functions create them.
+ */
+namespace binary_result {
+
+    /// microseconds between the Unix epoch and the PostgreSQL epoch (2000-01-01T00:00:00Z)
+    constexpr int64_t POSTGRES_EPOCH_OFFSET = 946684800000000;
+
+    /// OID of the data type `bigint`
+    constexpr uint32_t INT8_OID = 20;
+
+    /// WKB geometry type of a point
+    constexpr uint32_t WKB_POINT = 1;
+
+    /// EWKB flag indicating that a SRID follows the geometry type
+    constexpr uint32_t EWKB_SRID_FLAG = 0x20000000;
+
+    /// mask of all EWKB flags (Z, M and SRID)
+    constexpr uint32_t EWKB_FLAGS_MASK = 0xe0000000;
+
+    inline uint16_t decode_uint16(const char* data) {
+        const unsigned char* d = reinterpret_cast<const unsigned char*>(data);
+        return static_cast<uint16_t>((d[0] << 8) | d[1]);
+    }
+
+    inline uint32_t decode_uint32(const char* data) {
+        const unsigned char* d = reinterpret_cast<const unsigned char*>(data);
+        return (static_cast<uint32_t>(d[0]) << 24) | (static_cast<uint32_t>(d[1]) << 16)
+                | (static_cast<uint32_t>(d[2]) << 8) | static_cast<uint32_t>(d[3]);
+    }
+
+    inline uint64_t decode_uint64(const char* data) {
+        return (static_cast<uint64_t>(decode_uint32(data)) << 32) | decode_uint32(data + 4);
+    }
+
+    /**
+     * \brief Decode a 32-bit integer in little endian byte order (used by WKB).
+     */
+    inline uint32_t decode_uint32_le(const char* data) {
+        const unsigned char* d = reinterpret_cast<const unsigned char*>(data);
+        return (static_cast<uint32_t>(d[3]) << 24) | (static_cast<uint32_t>(d[2]) << 16)
+                | (static_cast<uint32_t>(d[1]) << 8) | static_cast<uint32_t>(d[0]);
+    }
+
+    /**
+     * \brief Decode a 64-bit integer in little endian byte order (used by WKB).
+     */
+    inline uint64_t decode_uint64_le(const char* data) {
+        return (static_cast<uint64_t>(decode_uint32_le(data + 4)) << 32) | decode_uint32_le(data);
+    }
+
+    /**
+     * \brief Decode a value of type `smallint`.
+     */
+    inline int16_t decode_int2(const char* data) {
+        return static_cast<int16_t>(decode_uint16(data));
+    }
+
+    /**
+     * \brief Decode a value of type `integer`.
+     */
+    inline int32_t decode_int4(const char* data) {
+        return static_cast<int32_t>(decode_uint32(data));
+    }
+
+    /**
+     * \brief Decode a value of type `bigint`.
+     */
+    inline int64_t decode_int8(const char* data) {
+        return static_cast<int64_t>(decode_uint64(data));
+    }
+
+    /**
+     * \brief Decode a value of type `double precision`.
+     */
+    inline double decode_float8(const char* data) {
+        uint64_t bits = decode_uint64(data);
+        double result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    /**
+     * \brief Decode a value of type `timestamp with time zone`.
+     *
+     * \returns seconds since the Unix epoch
+     */
+    inline int64_t decode_timestamptz(const char* data) {
+        int64_t microseconds = decode_int8(data) + POSTGRES_EPOCH_OFFSET;
+        // round towards negative infinity
+        return (microseconds >= 0) ? (microseconds / 1000000) : ((microseconds - 999999) / 1000000);
+    }
+
+    /**
+     * \brief Decode a point geometry in (E)WKB format.
+     *
+     * \param data pointer to the geometry
+     * \param length length of the geometry in bytes
+     *
+     * \throws std::runtime_error if the geometry is no point
+     */
+    inline osmium::Location decode_wkb_point(const char* data, const int length) {
+        if (length < 21) {
+            throw std::runtime_error{"WKB geometry is too short to be a point."};
+        }
+        const bool little_endian = (data[0] == 1);
+        uint32_t type = little_endian ? decode_uint32_le(data + 1) : decode_uint32(data + 1);
+        int offset = 5;
+        if (type & EWKB_SRID_FLAG) {
+            offset += 4;
+        }
+        if ((type & ~EWKB_FLAGS_MASK) != WKB_POINT || length < offset + 16) {
+            throw std::runtime_error{"WKB geometry is no point."};
+        }
+        uint64_t x_bits = little_endian ? decode_uint64_le(data + offset) : decode_uint64(data + offset);
+        uint64_t y_bits = little_endian ? decode_uint64_le(data + offset + 8) : decode_uint64(data + offset + 8);
+        double x;
+        double y;
+        memcpy(&x, &x_bits, sizeof(x));
+        memcpy(&y, &y_bits, sizeof(y));
+        return osmium::Location{x, y};
+    }
+
+    inline void encode_uint32(std::string& buffer, const uint32_t value) {
+        buffer.push_back(static_cast<char>((value >> 24) & 0xff));
+        buffer.push_back(static_cast<char>((value >> 16) & 0xff));
+        buffer.push_back(static_cast<char>((value >> 8) & 0xff));
+        buffer.push_back(static_cast<char>(value & 0xff));
+    }
+
+    inline void encode_uint64(std::string& buffer, const uint64_t value) {
+        encode_uint32(buffer, static_cast<uint32_t>(value >> 32));
+        encode_uint32(buffer, static_cast<uint32_t>(value & 0xffffffff));
+    }
+
+    /**
+     * \brief Encode a range of integers as a one-dimensional array of type `bigint[]`.
+     *
+     * \param begin iterator pointing to the first element
+     * \param end iterator pointing behind the last element
+     *
+     * \returns binary representation of the array
+     *
+     * \tparam TIterator iterator of a container of a signed integer type
+     */
+    template <typename TIterator>
+    std::string encode_int8_array(TIterator begin, TIterator end) {
+        std::string buffer;
+        const uint32_t count = static_cast<uint32_t>(std::distance(begin, end));
+        buffer.reserve(20 + count * 12);
+        encode_uint32(buffer, 1); // number of dimensions
+        encode_uint32(buffer, 0); // flags (contains no NULL)
+        encode_uint32(buffer, INT8_OID);
+        encode_uint32(buffer, count); // size of the dimension
+        encode_uint32(buffer, 1); // lower bound of the dimension
+        for (auto it = begin; it != end; ++it) {
+            encode_uint32(buffer, 8); // length of the element
+            encode_uint64(buffer, static_cast<uint64_t>(static_cast<int64_t>(*it)));
+        }
+        return buffer;
+    }
+
+    inline bool is_null(const PGresult* result, const int row, const int column) {
+        return PQgetisnull(result, row, column);
+    }
+
+    inline int16_t get_int2(const PGresult* result, const int row, const int column) {
+        return decode_int2(PQgetvalue(result, row, column));
+    }
+
+    inline int32_t get_int4(const PGresult* result, const int row, const int column) {
+        return decode_int4(PQgetvalue(result, row, column));
+    }
+
+    inline int64_t get_int8(const PGresult* result, const int row, const int column) {
+        return decode_int8(PQgetvalue(result, row, column));
+    }
+
+    inline double get_float8(const PGresult* result, const int row, const int column) {
+        return decode_float8(PQgetvalue(result, row, column));
+    }
+
+    inline int64_t get_timestamptz(const PGresult* result, const int row, const int column) {
+        return decode_timestamptz(PQgetvalue(result, row, column));
+    }
+
+    /**
+     * \brief Get the value of a column of type `text`.
+     *
+     * libpq terminates binary values with a null byte. Therefore, text can be used as a C string.
+     */
+    inline const char* get_text(const PGresult* result, const int row, const int column) {
+        return PQgetvalue(result, row, column);
+    }
+
+    inline osmium::Location get_wkb_point(const PGresult* result, const int row, const int column) {
+        return decode_wkb_point(PQgetvalue(result, row, column), PQgetlength(result, row, column));
+    }
+
+} // namespace binary_result
+
+#endif /* SRC_BINARY_RESULT_HPP_ */
@@ -91,16 +91,3 @@ bool BoundingBox::is_valid() {
 /* static */ double BoundingBox::radians_to_degree(double coordinate) {
     return (coordinate / osmium::geom::PI) * 180;
 }
-
-/*static*/ std::vector<BoundingBox> BoundingBox::read_tiles_list(const char* filename) {
-    std::vector<BoundingBox> tiles;
-    FILE * fp;
-    fp = fopen(filename, "r");
-    unsigned int x;
-    unsigned int y;
-    unsigned int zoom;
-    while (fscanf(fp, "%u/%u/%u", &zoom, &x, &y) == 3) {
-        tiles.push_back(BoundingBox(x, y, zoom));
-    }
-    return tiles;
-}
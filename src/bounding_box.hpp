@@ -115,15 +115,6 @@ public:
      * \returns coordinate in degree
      */
     static double radians_to_degree(double coordinate);
-
-    /**
-     * \brief Read list of expired tiles from file.
-     *
-     * \param filename null-terminated string containing the file name to read from
-     *
-     * \returns vector with one bounding box per tile
-     */
-    static std::vector<BoundingBox> read_tiles_list(const char* filename);
 };
 
 #endif /* SRC_BOUNDING_BOX_HPP_ */
@@ -0,0 +1,80 @@
+/*
+ * concurrency_controller.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include "concurrency_controller.hpp"
+
+constexpr int ConcurrencyController::WINDOW_QUERIES;
+constexpr double ConcurrencyController::DECREASE_FACTOR;
+constexpr double ConcurrencyController::BASELINE_WEIGHT;
+
+ConcurrencyController::ConcurrencyController(const int max, const double tolerance) :
+    m_mutex(),
+    m_available(),
+    m_max(std::max(max, 1)),
+    m_tolerance(tolerance) {
+}
+
+void ConcurrencyController::acquire() {
+    std::unique_lock<std::mutex> lock {m_mutex};
+    m_available.wait(lock, [this]() {
+        return m_inflight < static_cast<int>(m_limit);
+    });
+    ++m_inflight;
+}
+
+void ConcurrencyController::release() {
+    {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        --m_inflight;
+    }
+    m_available.notify_one();
+}
+
+void ConcurrencyController::record(const std::chrono::steady_clock::duration latency) {
+    {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        m_window_sum += std::chrono::duration<double>(latency).count();
+        ++m_window_count;
+        if (m_window_count < WINDOW_QUERIES) {
+            return;
+        }
+        end_window();
+    }
+    m_available.notify_all();
+}
+
+void ConcurrencyController::end_window() {
+    const double latency = m_window_sum / m_window_count;
+    m_window_sum = 0;
+    m_window_count = 0;
+    if (m_baseline < 0) {
+        m_baseline = latency;
+    }
+    // Windows with a single tile at once are not slowed down by this process. Their latency is
+    // the best one which can be reached.
+    const bool single_tile = m_limit < 2;
+    const bool congested = latency > m_baseline * m_tolerance;
+    if (congested) {
+        m_limit = std::max(1.0, m_limit * DECREASE_FACTOR);
+    } else {
+        m_limit = std::min(static_cast<double>(m_max), m_limit + 1);
+    }
+    if (!congested || single_tile) {
+        m_baseline += (latency - m_baseline) * BASELINE_WEIGHT;
+    }
+}
+
+int ConcurrencyController::limit() {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    return static_cast<int>(m_limit);
+}
+
+double ConcurrencyController::baseline() {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    return m_baseline;
+}
@@ -0,0 +1,111 @@
+/*
+ * concurrency_controller.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_CONCURRENCY_CONTROLLER_HPP_
+#define SRC_CONCURRENCY_CONTROLLER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * \brief Limit of the number of tiles created at once adapted to the latency of the spatial queries
+ *
+ * The limit is adapted using additive increase, multiplicative decrease (AIMD). The latencies of
+ * the spatial queries reported by all workers are grouped into windows of #WINDOW_QUERIES
+ * queries. If the mean latency of a window is higher than the baseline multiplied by the
+ * tolerance, the database is considered to be congested and the limit is decreased. Otherwise,
+ * the limit is increased by one.
+ *
+ * The baseline is a moving average of the latencies of windows without congestion. It follows
+ * slow changes of the latency caused by different tiles, e.g. tiles of other zoom levels. The
+ * limit starts at one tile to measure the latency of an idle database first.
+ *
+ * This class is thread-safe.
+ */
+class ConcurrencyController {
+public:
+    /// number of queries per window
+    static constexpr int WINDOW_QUERIES = 20;
+
+    /// factor the limit is multiplied by if the database is congested
+    static constexpr double DECREASE_FACTOR = 0.75;
+
+    /// weight of a window in the moving average of the baseline
+    static constexpr double BASELINE_WEIGHT = 0.05;
+
+private:
+    std::mutex m_mutex;
+
+    /// signalled if a tile is done or the limit increases
+    std::condition_variable m_available;
+
+    /// maximum limit
+    const int m_max;
+
+    /// tolerated ratio of the latency of a window and the baseline
+    const double m_tolerance;
+
+    /// current limit, the integral part is the number of tiles allowed at once
+    double m_limit = 1;
+
+    /// number of tiles being created
+    int m_inflight = 0;
+
+    /// baseline latency in seconds, negative if no window has been completed yet
+    double m_baseline = -1;
+
+    /// sum of the latencies of the current window in seconds
+    double m_window_sum = 0;
+
+    /// number of queries of the current window
+    int m_window_count = 0;
+
+    /**
+     * \brief Adapt the limit at the end of a window.
+     */
+    void end_window();
+
+public:
+    /**
+     * \param max maximum number of tiles created at once, at least 1
+     * \param tolerance tolerated ratio of the latency and the baseline latency, greater than 1
+     */
+    ConcurrencyController(const int max, const double tolerance);
+
+    ConcurrencyController(const ConcurrencyController&) = delete;
+    ConcurrencyController& operator=(const ConcurrencyController&) = delete;
+
+    /**
+     * \brief Wait until another tile may be created.
+     *
+     * Call release() after the tile has been created.
+     */
+    void acquire();
+
+    /**
+     * \brief Report that a tile acquired by acquire() has been created (or failed).
+     */
+    void release();
+
+    /**
+     * \brief Report the latency of a spatial query.
+     */
+    void record(const std::chrono::steady_clock::duration latency);
+
+    /**
+     * \brief current number of tiles allowed to be created at once
+     */
+    int limit();
+
+    /**
+     * \brief baseline latency in seconds, negative if not measured yet
+     */
+    double baseline();
+};
+
+#endif /* SRC_CONCURRENCY_CONTROLLER_HPP_ */
@@ -0,0 +1,60 @@
+/*
+ * connection_manager.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "connection_manager.hpp"
+
+ConnectionManager::ConnectionManager(const std::string& database) :
+    m_conninfo(conninfo(database)),
+    m_connections() {
+}
+
+ConnectionManager::~ConnectionManager() {
+    for (PGconn* connection : m_connections) {
+        if (connection) {
+            PQfinish(connection);
+        }
+    }
+}
+
+PGconn* ConnectionManager::get(const size_t slot) {
+    if (slot >= m_connections.size()) {
+        m_connections.resize(slot + 1, nullptr);
+    }
+    if (!m_connections[slot]) {
+        PGconn* connection = PQconnectdb(m_conninfo.c_str());
+        if (PQstatus(connection) != CONNECTION_OK) {
+            std::string message = PQerrorMessage(connection);
+            PQfinish(connection);
+            throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n")
+                % message).str());
+        }
+        m_connections[slot] = connection;
+    }
+    return m_connections[slot];
+}
+
+size_t ConnectionManager::size() const {
+    size_t count = 0;
+    for (PGconn* connection : m_connections) {
+        if (connection) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/*static*/ std::string ConnectionManager::conninfo(const std::string& database) {
+    if (database.find('=') != std::string::npos || database.compare(0, 13, "postgresql://") == 0
+            || database.compare(0, 11, "postgres://") == 0) {
+        return database;
+    }
+    std::string result = "dbname=";
+    result.append(database);
+    return result;
+}
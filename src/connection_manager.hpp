@@ -0,0 +1,78 @@
+/*
+ * connection_manager.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_CONNECTION_MANAGER_HPP_
+#define SRC_CONNECTION_MANAGER_HPP_
+
+#include <libpq-fe.h>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Small pool of database connections shared by multiple tables
+ *
+ * Tables request a connection by a slot number. Connections are established lazily when a slot
+ * is requested for the first time. Tables requesting the same slot share a connection.
+ *
+ * Tables sharing a connection must not send queries while the result of a query of another table
+ * sharing the same connection is pending (streamed or asynchronous queries). Use different slots
+ * for such tables.
+ *
+ * The manager has to outlive all tables using its connections.
+ */
+class ConnectionManager {
+    /// libpq connection string
+    std::string m_conninfo;
+
+    /// connections, index is the slot
+    std::vector<PGconn*> m_connections;
+
+public:
+    /**
+     * \param database name of the database or libpq connection string, see conninfo()
+     */
+    explicit ConnectionManager(const std::string& database);
+
+    ConnectionManager(const ConnectionManager&) = delete;
+
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    /**
+     * close all connections
+     */
+    ~ConnectionManager();
+
+    /**
+     * \brief Get the connection of a slot and establish it if necessary.
+     *
+     * \param slot slot number
+     *
+     * \returns connection, ownership is not transferred
+     *
+     * \throws std::runtime_error if the connection cannot be established
+     */
+    PGconn* get(const size_t slot = 0);
+
+    /**
+     * \brief Number of connections which are currently established.
+     */
+    size_t size() const;
+
+    /**
+     * \brief Build the libpq connection string for a database argument given by the user.
+     *
+     * The argument is used as is if it is a connection string (it contains a `=`) or a connection URI
+     * (it starts with `postgresql://` or `postgres://`). Otherwise, it is treated as the name of the database.
+     *
+     * \param database database argument
+     *
+     * \returns connection string
+     */
+    static std::string conninfo(const std::string& database);
+};
+
+#endif /* SRC_CONNECTION_MANAGER_HPP_ */
@@ -0,0 +1,18 @@
+/*
+ * content_digest.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <stdio.h>
+#include "content_digest.hpp"
+
+const uint64_t ContentDigest::OFFSET_BASIS;
+const uint64_t ContentDigest::PRIME;
+
+std::string ContentDigest::hex() const {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(m_hash));
+    return buffer;
+}
@@ -0,0 +1,63 @@
+/*
+ * content_digest.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_CONTENT_DIGEST_HPP_
+#define SRC_CONTENT_DIGEST_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "sidecar_file.hpp"
+
+/**
+ * \brief Digest of the content of a tile
+ *
+ * The digest is a 64 bit FNV-1a hash. It is used to detect tiles whose content did not change
+ * since they were written last time, not to protect against manipulation.
+ *
+ * The digest of a tile is stored in a sidecar file next to the tile (path of the tile with
+ * the suffix `.digest`), see sidecar().
+ */
+class ContentDigest {
+    /// FNV-1a offset basis
+    static const uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+
+    /// FNV-1a prime
+    static const uint64_t PRIME = 1099511628211ULL;
+
+    uint64_t m_hash = OFFSET_BASIS;
+
+public:
+    ContentDigest() = default;
+
+    /**
+     * \brief Add data to the digest.
+     */
+    void update(const void* data, const size_t length) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            m_hash ^= bytes[i];
+            m_hash *= PRIME;
+        }
+    }
+
+    /**
+     * \brief Get the digest as hexadecimal string.
+     */
+    std::string hex() const;
+
+    /**
+     * \brief Get the sidecar file storing the digest of a tile.
+     *
+     * \param path path of the tile
+     */
+    static SidecarFile sidecar(const std::string& path) {
+        return SidecarFile{path, "digest"};
+    }
+};
+
+#endif /* SRC_CONTENT_DIGEST_HPP_ */
@@ -0,0 +1,251 @@
+/*
+ * expire_watcher.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "connection_manager.hpp"
+#include "expire_watcher.hpp"
+
+const int ExpireWatcher::SETTLE_TIME;
+const int ExpireWatcher::MAX_DELAY;
+
+ExpireWatcher::ExpireWatcher(VectortileGeneratorConfig& config) :
+    m_directory(config.m_watch_directory),
+    m_channel(config.m_listen_channel),
+    m_verbose(config.m_verbose) {
+    if (!m_directory.empty()) {
+        if (m_directory.back() != '/') {
+            m_directory.push_back('/');
+        }
+        m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotify_fd == -1) {
+            throw std::runtime_error{(boost::format("inotify_init1() failed: %1%") % strerror(errno)).str()};
+        }
+        // IN_MOVED_TO: files renamed into the directory after they were written completely
+        if (inotify_add_watch(m_inotify_fd, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+            int error = errno;
+            close(m_inotify_fd);
+            throw std::runtime_error{(boost::format("Cannot watch directory %1%: %2%") % m_directory
+                    % strerror(error)).str()};
+        }
+    }
+    if (!m_channel.empty()) {
+        std::string conninfo = ConnectionManager::conninfo(config.m_postgres_config.m_database_name);
+        m_connection = PQconnectdb(conninfo.c_str());
+        if (PQstatus(m_connection) != CONNECTION_OK) {
+            std::string message = PQerrorMessage(m_connection);
+            PQfinish(m_connection);
+            if (m_inotify_fd != -1) {
+                close(m_inotify_fd);
+            }
+            throw std::runtime_error{(boost::format("Cannot establish connection to database: %1%")
+                    % message).str()};
+        }
+        char* channel = PQescapeIdentifier(m_connection, m_channel.c_str(), m_channel.size());
+        std::string query = "LISTEN ";
+        query += channel;
+        PQfreemem(channel);
+        PGresult* result = PQexec(m_connection, query.c_str());
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+            std::string message = PQresultErrorMessage(result);
+            PQclear(result);
+            PQfinish(m_connection);
+            if (m_inotify_fd != -1) {
+                close(m_inotify_fd);
+            }
+            throw std::runtime_error{(boost::format("%1% failed: %2%") % query % message).str()};
+        }
+        PQclear(result);
+    }
+}
+
+ExpireWatcher::~ExpireWatcher() {
+    if (m_inotify_fd != -1) {
+        close(m_inotify_fd);
+    }
+    if (m_connection) {
+        PQfinish(m_connection);
+    }
+}
+
+namespace {
+
+    const std::string CLAIMED_SUFFIX = ".processing";
+
+    bool is_claimed(const std::string& name) {
+        return name.size() > CLAIMED_SUFFIX.size() + 1 && name[0] == '.'
+                && !name.compare(name.size() - CLAIMED_SUFFIX.size(), std::string::npos, CLAIMED_SUFFIX);
+    }
+
+} // namespace
+
+bool ExpireWatcher::read_file(std::string name, TileList& tiles, const bool claimed) {
+    if (name.empty() || (name[0] == '.' && !claimed) || m_failed_files.count(name)) {
+        return false;
+    }
+    if (!claimed) {
+        // Further output appended to the file by the writer goes to a new file.
+        std::string claimed_name = "." + name + CLAIMED_SUFFIX;
+        if (rename((m_directory + name).c_str(), (m_directory + claimed_name).c_str()) == -1) {
+            if (errno != ENOENT) {
+                std::cerr << "ERROR: Failed to rename " << m_directory << name << ": " << strerror(errno) << '\n';
+                m_failed_files.insert(name);
+            }
+            return false;
+        }
+        name = claimed_name;
+    }
+    if (m_files.count(name)) {
+        return false;
+    }
+    std::string path = m_directory + name;
+    try {
+        tiles.read(path.c_str());
+    } catch (std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << ", ignoring " << path << '\n';
+        m_failed_files.insert(name);
+        return false;
+    }
+    if (m_verbose) {
+        std::cout << "Read " << path << '\n';
+    }
+    m_files.insert(name);
+    return true;
+}
+
+bool ExpireWatcher::scan_directory(TileList& tiles) {
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) {
+        throw std::runtime_error{(boost::format("Cannot read directory %1%: %2%") % m_directory
+                % strerror(errno)).str()};
+    }
+    bool found = false;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_type == DT_REG || entry->d_type == DT_UNKNOWN) {
+            // claimed files are left over from a previous run
+            found |= read_file(entry->d_name, tiles, is_claimed(entry->d_name));
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+bool ExpireWatcher::read_events(TileList& tiles) {
+    alignas(inotify_event) char buffer[4096];
+    bool found = false;
+    while (true) {
+        ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+        if (length == -1 && errno == EINTR) {
+            continue;
+        } else if (length == -1 && errno == EAGAIN) {
+            return found;
+        } else if (length <= 0) {
+            throw std::runtime_error{(boost::format("Reading inotify events failed: %1%") % strerror(errno)).str()};
+        }
+        for (char* pos = buffer; pos < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(pos);
+            if (event->mask & IN_Q_OVERFLOW) {
+                // events were lost
+                found |= scan_directory(tiles);
+            } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                found |= read_file(event->name, tiles, false);
+            }
+            pos += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+bool ExpireWatcher::read_notifications(TileList& tiles) {
+    if (!PQconsumeInput(m_connection)) {
+        throw std::runtime_error{(boost::format("Connection to database lost: %1%")
+                % PQerrorMessage(m_connection)).str()};
+    }
+    bool found = false;
+    while (PGnotify* notification = PQnotifies(m_connection)) {
+        const char* payload = notification->extra;
+        try {
+            tiles.parse(payload, payload + strlen(payload), "notification on channel " + m_channel);
+        } catch (std::runtime_error& e) {
+            std::cerr << "ERROR: " << e.what() << '\n';
+        }
+        PQfreemem(notification);
+        found = true;
+    }
+    return found;
+}
+
+void ExpireWatcher::wait(TileList& tiles) {
+    using clock = std::chrono::steady_clock;
+    bool found = false;
+    clock::time_point first_input;
+    if (!m_scanned && m_inotify_fd != -1) {
+        found = scan_directory(tiles);
+        first_input = clock::now();
+    }
+    m_scanned = true;
+    std::vector<pollfd> fds;
+    if (m_inotify_fd != -1) {
+        fds.push_back(pollfd{m_inotify_fd, POLLIN, 0});
+    }
+    if (m_connection) {
+        fds.push_back(pollfd{PQsocket(m_connection), POLLIN, 0});
+    }
+    while (true) {
+        int timeout = -1;
+        if (found) {
+            int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    clock::now() - first_input).count());
+            if (elapsed >= MAX_DELAY) {
+                return;
+            }
+            timeout = std::min(SETTLE_TIME, MAX_DELAY - elapsed);
+        }
+        int ret = poll(fds.data(), fds.size(), timeout);
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        } else if (ret == -1) {
+            throw std::runtime_error{(boost::format("poll() failed: %1%") % strerror(errno)).str()};
+        } else if (ret == 0) {
+            return;
+        }
+        bool input = false;
+        for (const pollfd& fd : fds) {
+            if (!fd.revents) {
+                continue;
+            }
+            if (fd.fd == m_inotify_fd) {
+                input |= read_events(tiles);
+            } else {
+                input |= read_notifications(tiles);
+            }
+        }
+        if (input && !found) {
+            found = true;
+            first_input = clock::now();
+        }
+    }
+}
+
+void ExpireWatcher::commit() {
+    for (const std::string& name : m_files) {
+        std::string path = m_directory + name;
+        if (unlink(path.c_str()) == -1 && errno != ENOENT) {
+            std::cerr << "ERROR: Failed to remove " << path << ": " << strerror(errno) << '\n';
+        }
+    }
+    m_files.clear();
+}
@@ -0,0 +1,129 @@
+/*
+ * expire_watcher.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_EXPIRE_WATCHER_HPP_
+#define SRC_EXPIRE_WATCHER_HPP_
+
+#include <libpq-fe.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "tile_list.hpp"
+#include "vectortile_generator_config.hpp"
+
+/**
+ * \brief Source of expired tiles in continuous mode
+ *
+ * The watcher reads lists of expired tiles which appear in a directory (inotify) and the payload
+ * of notifications on a PostgreSQL channel (LISTEN). Both sources are optional. The payload of a
+ * notification has the same format as an expire list.
+ *
+ * Files are renamed to `.NAME.processing` before they are read (further output appended by the
+ * writer goes to a new file) and removed by commit() after their tiles have been created. Renamed
+ * files left over from a previous run are read again. Hidden files are ignored otherwise, writers
+ * can create files under a hidden name and rename them when they are complete.
+ */
+class ExpireWatcher {
+    /// directory to watch, empty if no directory is watched
+    std::string m_directory;
+
+    /// channel to listen on, empty if no channel is used
+    std::string m_channel;
+
+    /// be verbose
+    bool m_verbose;
+
+    /// inotify instance
+    int m_inotify_fd = -1;
+
+    /// connection listening on m_channel
+    PGconn* m_connection = nullptr;
+
+    /// true if the files which were in m_directory before it was watched have been read
+    bool m_scanned = false;
+
+    /// renamed files in m_directory whose tiles have been read
+    std::set<std::string> m_files;
+
+    /// files in m_directory which could not be read, they are ignored
+    std::set<std::string> m_failed_files;
+
+    /**
+     * \brief Read all files of the directory which have not been read before.
+     *
+     * \returns true if a file was read
+     */
+    bool scan_directory(TileList& tiles);
+
+    /**
+     * \brief Rename a file of the directory and read it.
+     *
+     * Hidden files are ignored unless they have been renamed by a previous run.
+     *
+     * \param name name of the file
+     * \param tiles list to add the tiles to
+     * \param claimed true if the file has been renamed by a previous run already
+     *
+     * \returns true if the file was read
+     */
+    bool read_file(std::string name, TileList& tiles, const bool claimed);
+
+    /**
+     * \brief Handle pending inotify events.
+     *
+     * \returns true if a file was read
+     */
+    bool read_events(TileList& tiles);
+
+    /**
+     * \brief Handle pending notifications.
+     *
+     * \returns true if a notification was received
+     *
+     * \throws std::runtime_error if the connection to the database is broken
+     */
+    bool read_notifications(TileList& tiles);
+
+public:
+    /// time to wait for further input after the last input before returning from wait() in milliseconds
+    static const int SETTLE_TIME = 1000;
+
+    /// maximum time to collect input before returning from wait() in milliseconds
+    static const int MAX_DELAY = 10000;
+
+    /**
+     * \param config program configuration (m_watch_directory, m_listen_channel and m_postgres_config are used)
+     *
+     * \throws std::runtime_error if the directory cannot be watched or the connection to the database fails
+     */
+    explicit ExpireWatcher(VectortileGeneratorConfig& config);
+
+    ExpireWatcher(const ExpireWatcher&) = delete;
+    ExpireWatcher& operator=(const ExpireWatcher&) = delete;
+
+    ~ExpireWatcher();
+
+    /**
+     * \brief Wait for expired tiles and add them to a list.
+     *
+     * Files which are already in the directory are read on the first call. The method returns
+     * if there was no further input for #SETTLE_TIME milliseconds after an input or
+     * #MAX_DELAY milliseconds after the first input.
+     *
+     * \param tiles list of pending tiles, duplicates are dropped by the list
+     *
+     * \throws std::runtime_error if waiting fails
+     */
+    void wait(TileList& tiles);
+
+    /**
+     * \brief Remove all files read since the last call because their tiles have been created.
+     */
+    void commit();
+};
+
+#endif /* SRC_EXPIRE_WATCHER_HPP_ */
@@ -0,0 +1,277 @@
+/*
+ * http_server.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <errno.h>
+#include <ftw.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "tile_list.hpp"
+#include "http_server.hpp"
+
+namespace {
+
+    /// maximum size of a request header
+    const size_t MAX_REQUEST_SIZE = 8192;
+
+    /// timeout for reading requests and sending responses in seconds
+    const int SOCKET_TIMEOUT = 10;
+
+    /**
+     * \brief Parse a non-negative integer and advance the position.
+     *
+     * \returns false if there is no digit at the position or the number is too large
+     */
+    bool parse_number(std::string::const_iterator& pos, const std::string::const_iterator end, int& value) {
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return false;
+        }
+        long result = 0;
+        while (pos != end && *pos >= '0' && *pos <= '9') {
+            result = result * 10 + (*pos - '0');
+            if (result > (1 << TileList::MAX_ZOOM)) {
+                return false;
+            }
+            ++pos;
+        }
+        value = static_cast<int>(result);
+        return true;
+    }
+
+    const char* status_text(const int status) {
+        switch (status) {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        default:
+            return "Internal Server Error";
+        }
+    }
+
+    bool send_all(const int fd, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+            if (sent == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += sent;
+            length -= sent;
+        }
+        return true;
+    }
+
+    int listen_unix(const std::string& path) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error{(boost::format("Socket path %1% is too long") % path).str()};
+        }
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        // remove the socket of a previous run
+        struct stat stat_result;
+        if (stat(path.c_str(), &stat_result) == 0 && S_ISSOCK(stat_result.st_mode)) {
+            unlink(path.c_str());
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            throw std::runtime_error{(boost::format("Failed to create socket: %1%") % strerror(errno)).str()};
+        }
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error{(boost::format("Failed to bind to %1%: %2%") % path % strerror(error)).str()};
+        }
+        return fd;
+    }
+
+    int listen_tcp(const std::string& address) {
+        std::string host = "127.0.0.1";
+        std::string port = address;
+        size_t colon = address.rfind(':');
+        if (colon != std::string::npos) {
+            host = address.substr(0, colon);
+            port = address.substr(colon + 1);
+        }
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* result;
+        int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+        if (ret != 0) {
+            throw std::runtime_error{(boost::format("Invalid address %1%: %2%") % address % gai_strerror(ret)).str()};
+        }
+        int fd = -1;
+        int error = 0;
+        for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd == -1) {
+                error = errno;
+                continue;
+            }
+            int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                break;
+            }
+            error = errno;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        if (fd == -1) {
+            throw std::runtime_error{(boost::format("Failed to bind to %1%: %2%") % address % strerror(error)).str()};
+        }
+        return fd;
+    }
+
+} // namespace
+
+http_server::Request http_server::parse_request(const std::string& request, const std::string& suffix) {
+    Request result;
+    size_t line_end = request.find_first_of("\r\n");
+    std::string line = request.substr(0, line_end);
+    size_t path_begin = line.find(' ');
+    if (path_begin == std::string::npos) {
+        return result;
+    }
+    std::string method = line.substr(0, path_begin);
+    if (method != "GET") {
+        result.status = 405;
+        return result;
+    }
+    size_t path_end = line.find(' ', path_begin + 1);
+    std::string path = line.substr(path_begin + 1, path_end == std::string::npos ? std::string::npos
+            : path_end - path_begin - 1);
+    // strip query string
+    path = path.substr(0, path.find('?'));
+    std::string::const_iterator pos = path.begin();
+    const std::string::const_iterator end = path.end();
+    result.status = 404;
+    if (pos == end || *pos++ != '/' || !parse_number(pos, end, result.zoom)
+            || pos == end || *pos++ != '/' || !parse_number(pos, end, result.x)
+            || pos == end || *pos++ != '/' || !parse_number(pos, end, result.y)) {
+        return result;
+    }
+    if (pos != end && std::string(pos, end) != "." + suffix) {
+        return result;
+    }
+    if (result.zoom > TileList::MAX_ZOOM || result.x >= (1 << result.zoom) || result.y >= (1 << result.zoom)) {
+        return result;
+    }
+    result.status = 200;
+    return result;
+}
+
+int http_server::listen(const std::string& address) {
+    int fd;
+    if (address.find('/') != std::string::npos) {
+        fd = listen_unix(address);
+    } else {
+        fd = listen_tcp(address);
+    }
+    if (::listen(fd, SOMAXCONN) == -1) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error{(boost::format("Failed to listen on %1%: %2%") % address % strerror(error)).str()};
+    }
+    return fd;
+}
+
+bool http_server::read_request(const int fd, std::string& request) {
+    timeval timeout;
+    timeout.tv_sec = SOCKET_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    request.clear();
+    char buffer[1024];
+    while (request.size() < MAX_REQUEST_SIZE) {
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count == -1 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return false;
+        }
+        request.append(buffer, count);
+        if (request.find("\r\n\r\n") != std::string::npos || request.find("\n\n") != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void http_server::send_response(const int fd, const int status, const char* content_type, const std::string& body) {
+    std::string header = (boost::format("HTTP/1.0 %1% %2%\r\nContent-Type: %3%\r\nContent-Length: %4%\r\n"
+            "Connection: close\r\n\r\n") % status % status_text(status) % content_type % body.size()).str();
+    if (send_all(fd, header.data(), header.size())) {
+        send_all(fd, body.data(), body.size());
+    }
+    close(fd);
+}
+
+const char* http_server::content_type(const std::string& suffix) {
+    if (suffix == "osm") {
+        return "application/xml";
+    } else if (suffix == "opl") {
+        return "text/plain";
+    }
+    return "application/octet-stream";
+}
+
+std::string http_server::read_file(const std::string& path) {
+    std::ifstream file {path, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error{(boost::format("Failed to read %1%") % path).str()};
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+std::string http_server::make_temp_directory() {
+    const char* tmpdir = getenv("TMPDIR");
+    std::string path = tmpdir ? tmpdir : "/tmp";
+    path += "/cerepso2vt-XXXXXX";
+    if (!mkdtemp(&path[0])) {
+        throw std::runtime_error{(boost::format("Failed to create temporary directory: %1%") % strerror(errno)).str()};
+    }
+    path.push_back('/');
+    return path;
+}
+
+namespace {
+
+    int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+        return remove(path);
+    }
+
+} // namespace
+
+bool http_server::remove_directory(const std::string& path) {
+    // FTW_DEPTH visits the contents of a directory before the directory itself.
+    return nftw(path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS) == 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * http_server.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_HTTP_SERVER_HPP_
+#define SRC_HTTP_SERVER_HPP_
+
+#include <string>
+
+/**
+ * \brief Minimal HTTP server functions used by the server mode.
+ */
+namespace http_server {
+
+    /**
+     * \brief Tile requested by a client.
+     */
+    struct Request {
+        /// HTTP status code, 200 if the request is valid
+        int status = 400;
+        int x = 0;
+        int y = 0;
+        int zoom = 0;
+    };
+
+    /**
+     * \brief Parse the request line of a HTTP request.
+     *
+     * Accepted requests are `GET /zoom/x/y` and `GET /zoom/x/y.SUFFIX` where SUFFIX is the
+     * configured file suffix.
+     *
+     * \param request request header
+     * \param suffix file suffix of the output format
+     *
+     * \returns parsed request, its status is not 200 if the request is invalid
+     */
+    Request parse_request(const std::string& request, const std::string& suffix);
+
+    /**
+     * \brief Open a listening socket.
+     *
+     * \param address path of a Unix domain socket (if it contains a slash) or `[HOST:]PORT` of a TCP
+     * socket. The default host is 127.0.0.1.
+     *
+     * \returns file descriptor of the socket
+     *
+     * \throws std::runtime_error if the socket cannot be opened
+     */
+    int listen(const std::string& address);
+
+    /**
+     * \brief Read the header of a HTTP request.
+     *
+     * \param fd socket of the client
+     * \param request header (output)
+     *
+     * \returns false if the connection was closed or timed out before the header was complete
+     */
+    bool read_request(const int fd, std::string& request);
+
+    /**
+     * \brief Send a HTTP response and close the connection.
+     *
+     * \param fd socket of the client
+     * \param status HTTP status code
+     * \param content_type content type of the body
+     * \param body body
+     */
+    void send_response(const int fd, const int status, const char* content_type, const std::string& body);
+
+    /**
+     * \brief Get the content type of an output format.
+     */
+    const char* content_type(const std::string& suffix);
+
+    /**
+     * \brief Read a file into a string.
+     *
+     * \throws std::runtime_error if the file cannot be read
+     */
+    std::string read_file(const std::string& path);
+
+    /**
+     * \brief Create a private temporary directory.
+     *
+     * \returns path of the directory with a trailing slash
+     */
+    std::string make_temp_directory();
+
+    /**
+     * \brief Remove a directory and everything inside it.
+     *
+     * \returns false if the directory or any of its contents could not be removed
+     */
+    bool remove_directory(const std::string& path);
+
+} // namespace http_server
+
+#endif /* SRC_HTTP_SERVER_HPP_ */
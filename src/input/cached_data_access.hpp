@@ -0,0 +1,475 @@
+/*
+ * cached_data_access.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_INPUT_CACHED_DATA_ACCESS_HPP_
+#define SRC_INPUT_CACHED_DATA_ACCESS_HPP_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <osmium/osm/item_type.hpp>
+#include "column_config_parser.hpp"
+#include "../lru_cache.hpp"
+#include "../metatile.hpp"
+#include "../osm_vector_tile_impl_definitions.hpp"
+#include "../vectortile_generator_config.hpp"
+
+namespace input {
+
+    /**
+     * \brief Copy of a C string passed to the callbacks of the data access implementations which may be a null pointer
+     */
+    class NullableString {
+        std::string m_value;
+        bool m_null;
+
+    public:
+        explicit NullableString(const char* value) :
+            m_value(value ? value : ""),
+            m_null(!value) {
+        }
+
+        const char* get() const {
+            return m_null ? nullptr : m_value.c_str();
+        }
+
+        size_t bytes() const {
+            return sizeof(NullableString) + m_value.size();
+        }
+    };
+
+    /**
+     * \brief Copy of the metadata of an object passed to the callbacks of the data access implementations
+     */
+    struct CachedMetadata {
+        NullableString version;
+        NullableString changeset;
+        NullableString uid;
+        NullableString timestamp;
+
+        CachedMetadata(const char* v, const char* c, const char* u, const char* t) :
+            version(v),
+            changeset(c),
+            uid(u),
+            timestamp(t) {
+        }
+
+        size_t bytes() const {
+            return version.bytes() + changeset.bytes() + uid.bytes() + timestamp.bytes();
+        }
+    };
+
+    /**
+     * \brief Cache entry of an object
+     */
+    struct CachedObject {
+        /// add the object to the tile by calling the callback of OSMVectorTileImpl
+        std::function<void()> add;
+        /// IDs of the members of a relation which are relations
+        std::vector<osmium::object_id_type> relation_members;
+    };
+
+    /**
+     * \brief Hash function of the keys of the object cache (type and ID of the object)
+     */
+    struct ObjectKeyHash {
+        size_t operator()(const std::pair<osmium::item_type, osmium::object_id_type>& key) const {
+            return std::hash<osmium::object_id_type>()(key.second) ^ (static_cast<size_t>(key.first) << 60);
+        }
+    };
+
+    /**
+     * \brief Data access which keeps nodes, ways and relations of previous tiles in a cache.
+     *
+     * The cache sits between a data access implementation and OSMVectorTileImpl. It keeps a copy
+     * of every object passed to the callbacks of OSMVectorTileImpl. Missing nodes, ways and relations
+     * of a tile are taken from the cache if possible. Only the others are queried from the database.
+     * Spatial queries are not affected. The cache is bounded by VectortileGeneratorConfig::m_cache_size
+     * bytes, the least recently used objects are evicted first.
+     *
+     * The cache uses the additional columns passed to the callbacks after the callback returned.
+     * Therefore, they have to outlive the cache (they belong to the ColumnConfigParser).
+     *
+     * \tparam TDataAccess data access implementation
+     */
+    template <typename TDataAccess>
+    class CachedDataAccess {
+        using key_type = std::pair<osmium::item_type, osmium::object_id_type>;
+
+        VectortileGeneratorConfig& m_config;
+
+        TDataAccess m_data_access;
+
+        LruCache<key_type, CachedObject, ObjectKeyHash> m_cache;
+
+        /// number of missing objects found in the cache
+        size_t m_hits = 0;
+
+        /// number of missing objects queried from the database
+        size_t m_misses = 0;
+
+        osm_vector_tile_impl::node_callback_type m_add_node_callback;
+        osm_vector_tile_impl::node_without_tags_callback_type m_add_node_without_tags_callback;
+        osm_vector_tile_impl::simple_node_callback_type m_add_simple_node_callback;
+        osm_vector_tile_impl::way_callback_type m_add_way_callback;
+        osm_vector_tile_impl::slim_way_callback_type m_add_slim_way_callback;
+        osm_vector_tile_impl::relation_callback_type m_add_relation_callback;
+        osm_vector_tile_impl::slim_relation_callback_type m_add_slim_relation_callback;
+
+        static std::vector<NullableString> copy_values(const std::vector<const char*>& values) {
+            std::vector<NullableString> result;
+            result.reserve(values.size());
+            for (const char* v : values) {
+                result.emplace_back(v);
+            }
+            return result;
+        }
+
+        static std::vector<const char*> pointers(const std::vector<NullableString>& values) {
+            std::vector<const char*> result;
+            result.reserve(values.size());
+            for (const NullableString& v : values) {
+                result.push_back(v.get());
+            }
+            return result;
+        }
+
+        static size_t bytes(const std::vector<NullableString>& values) {
+            size_t result = 0;
+            for (const NullableString& v : values) {
+                result += v.bytes();
+            }
+            return result;
+        }
+
+        static size_t bytes(const std::vector<osm_vector_tile_impl::StringPair>& tags) {
+            size_t result = 0;
+            for (const osm_vector_tile_impl::StringPair& tag : tags) {
+                result += sizeof(tag) + tag.first.size() + tag.second.size();
+            }
+            return result;
+        }
+
+        static size_t bytes(const std::vector<osm_vector_tile_impl::MemberIdRoleTypePos>& members) {
+            size_t result = 0;
+            for (const osm_vector_tile_impl::MemberIdRoleTypePos& member : members) {
+                result += sizeof(member) + member.role.size();
+            }
+            return result;
+        }
+
+        static std::vector<osmium::object_id_type> relation_members(
+                const std::vector<osm_vector_tile_impl::MemberIdRoleTypePos>& members) {
+            std::vector<osmium::object_id_type> result;
+            for (const osm_vector_tile_impl::MemberIdRoleTypePos& member : members) {
+                if (member.type == osmium::item_type::relation) {
+                    result.push_back(member.id);
+                }
+            }
+            return result;
+        }
+
+        /**
+         * \brief Check if an object is cached already and mark it as recently used.
+         */
+        bool cached(const osmium::item_type type, const osmium::object_id_type id) {
+            return m_cache.find(key_type{type, id}) != nullptr;
+        }
+
+        void insert(const osmium::item_type type, const osmium::object_id_type id, CachedObject&& object,
+                const size_t bytes) {
+            m_cache.insert(key_type{type, id}, std::move(object), bytes + sizeof(CachedObject));
+        }
+
+        /**
+         * \brief Add cached objects to the tile and collect the IDs which are not cached.
+         */
+        osm_vector_tile_impl::osm_id_set_type add_cached(const osmium::item_type type,
+                const osm_vector_tile_impl::osm_id_set_type& ids) {
+            osm_vector_tile_impl::osm_id_set_type not_cached;
+            // Adding objects may modify the set of missing objects of OSMVectorTileImpl.
+            std::vector<osmium::object_id_type> id_list {ids.begin(), ids.end()};
+            for (const osmium::object_id_type id : id_list) {
+                CachedObject* object = m_cache.find(key_type{type, id});
+                if (object) {
+                    ++m_hits;
+                    object->add();
+                } else {
+                    ++m_misses;
+                    not_cached.insert(id);
+                }
+            }
+            return not_cached;
+        }
+
+    public:
+        CachedDataAccess(VectortileGeneratorConfig& config, ColumnConfigParser& column_config_parser) :
+            m_config(config),
+            m_data_access(config, column_config_parser),
+            m_cache(config.m_cache_size) {
+        }
+
+        /**
+         * Objects must not be cached yet because the cached callbacks refer to this instance.
+         */
+        CachedDataAccess(CachedDataAccess&& other) :
+            m_config(other.m_config),
+            m_data_access(std::move(other.m_data_access)),
+            m_cache(other.m_config.m_cache_size) {
+        }
+
+        /// number of missing objects found in the cache
+        size_t hits() const {
+            return m_hits;
+        }
+
+        /// number of missing objects queried from the database
+        size_t misses() const {
+            return m_misses;
+        }
+
+        /// number of cached objects
+        size_t cached_objects() const {
+            return m_cache.size();
+        }
+
+        void set_bbox(const BoundingBox& bbox) {
+            m_data_access.set_bbox(bbox);
+        }
+
+        void set_metatile(const Metatile& metatile) {
+            m_data_access.set_metatile(metatile);
+        }
+
+        void set_latency_callback(OSMDataTable::latency_callback_type callback) {
+            m_data_access.set_latency_callback(callback);
+        }
+
+        std::string source_state(const BoundingBox& bbox) {
+            return m_data_access.source_state(bbox);
+        }
+
+        double estimate_rows(const BoundingBox& bbox) {
+            return m_data_access.estimate_rows(bbox);
+        }
+
+        void set_add_node_callback(osm_vector_tile_impl::node_callback_type&& callback,
+                osm_vector_tile_impl::node_without_tags_callback_type&& callback_without_tags,
+                osm_vector_tile_impl::simple_node_callback_type&& simple_callback) {
+            m_add_node_callback = std::move(callback);
+            m_add_node_without_tags_callback = std::move(callback_without_tags);
+            m_add_simple_node_callback = std::move(simple_callback);
+            m_data_access.set_add_node_callback(
+                [this](const osmium::object_id_type id, osmium::Location& location, const char* version,
+                        const char* changeset, const char* uid, const char* timestamp, const std::string tags,
+                        const postgres_drivers::ColumnsVector& additional_columns,
+                        const std::vector<const char*>& additional_values) {
+                    m_add_node_callback(id, location, version, changeset, uid, timestamp, tags,
+                            additional_columns, additional_values);
+                    if (cached(osmium::item_type::node, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    std::vector<NullableString> values = copy_values(additional_values);
+                    const size_t size = metadata.bytes() + tags.size() + bytes(values);
+                    const postgres_drivers::ColumnsVector* columns = &additional_columns;
+                    const osmium::Location loc = location;
+                    insert(osmium::item_type::node, id, CachedObject{[this, id, loc, metadata, tags, columns, values]() {
+                        osmium::Location l = loc;
+                        m_add_node_callback(id, l, metadata.version.get(), metadata.changeset.get(),
+                                metadata.uid.get(), metadata.timestamp.get(), tags, *columns, pointers(values));
+                    }, {}}, size);
+                },
+                [this](const osmium::object_id_type id, osmium::Location& location, const char* version,
+                        const char* changeset, const char* uid, const char* timestamp) {
+                    m_add_node_without_tags_callback(id, location, version, changeset, uid, timestamp);
+                    if (cached(osmium::item_type::node, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    const size_t size = metadata.bytes();
+                    const osmium::Location loc = location;
+                    insert(osmium::item_type::node, id, CachedObject{[this, id, loc, metadata]() {
+                        osmium::Location l = loc;
+                        m_add_node_without_tags_callback(id, l, metadata.version.get(), metadata.changeset.get(),
+                                metadata.uid.get(), metadata.timestamp.get());
+                    }, {}}, size);
+                },
+                [this](const osmium::object_id_type id, osmium::Location& location) {
+                    m_add_simple_node_callback(id, location);
+                    if (cached(osmium::item_type::node, id)) {
+                        return;
+                    }
+                    const osmium::Location loc = location;
+                    insert(osmium::item_type::node, id, CachedObject{[this, id, loc]() {
+                        osmium::Location l = loc;
+                        m_add_simple_node_callback(id, l);
+                    }, {}}, 0);
+                }
+            );
+        }
+
+        void set_add_way_callback(osm_vector_tile_impl::way_callback_type&& callback,
+                osm_vector_tile_impl::slim_way_callback_type&& slim_callback) {
+            m_add_way_callback = std::move(callback);
+            m_add_slim_way_callback = std::move(slim_callback);
+            m_data_access.set_add_way_callback(
+                [this](const osmium::object_id_type id, const std::vector<postgres_drivers::MemberIdPos> nodes,
+                        const char* version, const char* changeset, const char* uid, const char* timestamp,
+                        const std::string tags, const postgres_drivers::ColumnsVector& additional_columns,
+                        const std::vector<const char*>& additional_values) {
+                    m_add_way_callback(id, nodes, version, changeset, uid, timestamp, tags, additional_columns,
+                            additional_values);
+                    if (cached(osmium::item_type::way, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    std::vector<NullableString> values = copy_values(additional_values);
+                    const size_t size = metadata.bytes() + tags.size() + bytes(values)
+                            + nodes.size() * sizeof(postgres_drivers::MemberIdPos);
+                    const postgres_drivers::ColumnsVector* columns = &additional_columns;
+                    insert(osmium::item_type::way, id, CachedObject{[this, id, nodes, metadata, tags, columns, values]() {
+                        m_add_way_callback(id, nodes, metadata.version.get(), metadata.changeset.get(),
+                                metadata.uid.get(), metadata.timestamp.get(), tags, *columns, pointers(values));
+                    }, {}}, size);
+                },
+                [this](const osmium::object_id_type id, const std::vector<postgres_drivers::MemberIdPos> nodes,
+                        const char* version, const char* changeset, const char* uid, const char* timestamp,
+                        const std::vector<osm_vector_tile_impl::StringPair>& tags) {
+                    m_add_slim_way_callback(id, nodes, version, changeset, uid, timestamp, tags);
+                    if (cached(osmium::item_type::way, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    const size_t size = metadata.bytes() + bytes(tags)
+                            + nodes.size() * sizeof(postgres_drivers::MemberIdPos);
+                    insert(osmium::item_type::way, id, CachedObject{[this, id, nodes, metadata, tags]() {
+                        m_add_slim_way_callback(id, nodes, metadata.version.get(), metadata.changeset.get(),
+                                metadata.uid.get(), metadata.timestamp.get(), tags);
+                    }, {}}, size);
+                }
+            );
+        }
+
+        void set_add_relation_callback(osm_vector_tile_impl::relation_callback_type&& callback,
+                osm_vector_tile_impl::slim_relation_callback_type&& slim_callback) {
+            m_add_relation_callback = std::move(callback);
+            m_add_slim_relation_callback = std::move(slim_callback);
+            m_data_access.set_add_relation_callback(
+                [this](const osmium::object_id_type id,
+                        const std::vector<osm_vector_tile_impl::MemberIdRoleTypePos> members,
+                        const char* version, const char* changeset, const char* uid, const char* timestamp,
+                        const std::string tags, const postgres_drivers::ColumnsVector& additional_columns,
+                        const std::vector<const char*>& additional_values) {
+                    m_add_relation_callback(id, members, version, changeset, uid, timestamp, tags,
+                            additional_columns, additional_values);
+                    if (cached(osmium::item_type::relation, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    std::vector<NullableString> values = copy_values(additional_values);
+                    const size_t size = metadata.bytes() + tags.size() + bytes(values) + bytes(members);
+                    const postgres_drivers::ColumnsVector* columns = &additional_columns;
+                    insert(osmium::item_type::relation, id, CachedObject{
+                        [this, id, members, metadata, tags, columns, values]() {
+                            m_add_relation_callback(id, members, metadata.version.get(), metadata.changeset.get(),
+                                    metadata.uid.get(), metadata.timestamp.get(), tags, *columns, pointers(values));
+                        }, relation_members(members)}, size);
+                },
+                [this](const osmium::object_id_type id,
+                        const std::vector<osm_vector_tile_impl::MemberIdRoleTypePos> members,
+                        const char* version, const char* changeset, const char* uid, const char* timestamp,
+                        const std::vector<osm_vector_tile_impl::StringPair>& tags) {
+                    m_add_slim_relation_callback(id, members, version, changeset, uid, timestamp, tags);
+                    if (cached(osmium::item_type::relation, id)) {
+                        return;
+                    }
+                    CachedMetadata metadata {version, changeset, uid, timestamp};
+                    const size_t size = metadata.bytes() + bytes(tags) + bytes(members);
+                    insert(osmium::item_type::relation, id, CachedObject{[this, id, members, metadata, tags]() {
+                        m_add_slim_relation_callback(id, members, metadata.version.get(), metadata.changeset.get(),
+                                metadata.uid.get(), metadata.timestamp.get(), tags);
+                    }, relation_members(members)}, size);
+                }
+            );
+        }
+
+        void get_nodes_inside() {
+            m_data_access.get_nodes_inside();
+        }
+
+        void get_ways_inside() {
+            m_data_access.get_ways_inside();
+        }
+
+        void get_relations_inside() {
+            m_data_access.get_relations_inside();
+        }
+
+        void get_objects_inside() {
+            m_data_access.get_objects_inside();
+        }
+
+        void get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes) {
+            osm_vector_tile_impl::osm_id_set_type not_cached = add_cached(osmium::item_type::node, missing_nodes);
+            if (!not_cached.empty()) {
+                m_data_access.get_missing_nodes(not_cached);
+            }
+        }
+
+        void get_missing_ways(const osm_vector_tile_impl::osm_id_set_type& missing_ways) {
+            osm_vector_tile_impl::osm_id_set_type not_cached = add_cached(osmium::item_type::way, missing_ways);
+            if (!not_cached.empty()) {
+                m_data_access.get_missing_ways(not_cached);
+            }
+        }
+
+        /**
+         * \brief Get all missing relations and all relations which are members of them (recursively).
+         *
+         * Nested relations of cached relations are taken from the cache, too. The closure of all
+         * relations which are not cached is queried from the database.
+         */
+        void get_missing_relations(const osm_vector_tile_impl::osm_id_set_type& missing_relations) {
+            osm_vector_tile_impl::osm_id_set_type visited(missing_relations);
+            osm_vector_tile_impl::osm_id_set_type not_cached;
+            // IDs and nesting depth of the relations to add
+            std::vector<std::pair<osmium::object_id_type, int>> pending;
+            for (const osmium::object_id_type id : missing_relations) {
+                pending.emplace_back(id, 0);
+            }
+            while (!pending.empty()) {
+                const osmium::object_id_type id = pending.back().first;
+                const int depth = pending.back().second;
+                pending.pop_back();
+                CachedObject* object = m_cache.find(key_type{osmium::item_type::relation, id});
+                if (!object) {
+                    ++m_misses;
+                    not_cached.insert(id);
+                    continue;
+                }
+                ++m_hits;
+                object->add();
+                if (m_config.m_max_relation_depth > 0 && depth >= m_config.m_max_relation_depth) {
+                    continue;
+                }
+                for (const osmium::object_id_type member : object->relation_members) {
+                    if (visited.insert(member).second) {
+                        pending.emplace_back(member, depth + 1);
+                    }
+                }
+            }
+            if (!not_cached.empty()) {
+                m_data_access.get_missing_relations(not_cached);
+            }
+        }
+    };
+
+} // namespace input
+
+#endif /* SRC_INPUT_CACHED_DATA_ACCESS_HPP_ */
@@ -7,10 +7,13 @@
 
 #include "cerepso_data_access.hpp"
 #include "nodes_provider_factory.hpp"
+#include "relation_closure.hpp"
+#include "../binary_result.hpp"
+#include <assert.h>
 #include <algorithm>
 
 OSMDataTable input::CerepsoDataAccess::build_table(const char* name,
-        VectortileGeneratorConfig& config, postgres_drivers::TableType type,
+        VectortileGeneratorConfig& config, PGconn* connection, postgres_drivers::TableType type,
         postgres_drivers::ColumnsVector* additional_columns = nullptr) {
     postgres_drivers::Columns cols {config.m_postgres_config, type};
     if (additional_columns) {
@@ -18,24 +21,35 @@ OSMDataTable input::CerepsoDataAccess::build_table(const char* name,
             cols.push_back(c);
         }
     }
-    return OSMDataTable{name, config.m_postgres_config, std::move(cols)};
+    OSMDataTable table {name, config.m_postgres_config, std::move(cols), connection};
+    table.set_chunk_size(config.m_chunk_size);
+    if (config.metatiles_enabled()) {
+        table.enable_metatiles();
+    }
+    return table;
 }
 
 input::CerepsoDataAccess::CerepsoDataAccess(VectortileGeneratorConfig& config,
         input::ColumnConfigParser& column_config_parser) :
     m_column_config_parser(column_config_parser),
     m_config(config),
-    m_ways_table(build_table("planet_osm_line", config, postgres_drivers::TableType::WAYS_LINEAR, &(column_config_parser.line_columns()))),
-    m_relations_table(build_table("relations", config, postgres_drivers::TableType::RELATION_OTHER, &(column_config_parser.line_columns()))),
-    m_node_ways_table(build_table("node_ways", config, postgres_drivers::TableType::NODE_WAYS)),
-    m_node_relations_table(build_table("node_relations", config, postgres_drivers::TableType::RELATION_MEMBER_NODES)),
-    m_way_relations_table(build_table("way_relations", config, postgres_drivers::TableType::RELATION_MEMBER_WAYS)),
-    m_relation_relations_table(build_table("relation_relations", config, postgres_drivers::TableType::RELATION_MEMBER_RELATIONS)),
+    m_connection_manager(new ConnectionManager(config.m_postgres_config.m_database_name)),
+    m_ways_table(build_table("planet_osm_line", config, connection(WAYS_SLOT), postgres_drivers::TableType::WAYS_LINEAR, &(column_config_parser.line_columns()))),
+    m_relations_table(build_table("relations", config, connection(RELATIONS_SLOT), postgres_drivers::TableType::RELATION_OTHER, &(column_config_parser.line_columns()))),
+    m_node_ways_table(build_table("node_ways", config, connection(MEMBERS_SLOT), postgres_drivers::TableType::NODE_WAYS)),
+    m_node_relations_table(build_table("node_relations", config, connection(MEMBERS_SLOT), postgres_drivers::TableType::RELATION_MEMBER_NODES)),
+    m_way_relations_table(build_table("way_relations", config, connection(MEMBERS_SLOT), postgres_drivers::TableType::RELATION_MEMBER_WAYS)),
+    m_relation_relations_table(build_table("relation_relations", config, connection(MEMBERS_SLOT), postgres_drivers::TableType::RELATION_MEMBER_RELATIONS)),
     m_metadata_fields(config) {
     // initialize the implementaion used to produce the vector tile
-    OSMDataTable nodes_table = build_table("planet_osm_point", config, postgres_drivers::TableType::POINT, &(column_config_parser.point_columns()));
+    OSMDataTable nodes_table = build_table("planet_osm_point", config, connection(NODES_SLOT), postgres_drivers::TableType::POINT, &(column_config_parser.point_columns()));
     if (config.m_flatnodes_path == "") {
-        OSMDataTable untagged_nodes_table {"untagged_nodes", config.m_postgres_config, {config.m_postgres_config, postgres_drivers::TableType::UNTAGGED_POINT}};
+        OSMDataTable untagged_nodes_table {"untagged_nodes", config.m_postgres_config, {config.m_postgres_config, postgres_drivers::TableType::UNTAGGED_POINT},
+                connection(UNTAGGED_NODES_SLOT)};
+        untagged_nodes_table.set_chunk_size(config.m_chunk_size);
+        if (config.metatiles_enabled()) {
+            untagged_nodes_table.enable_metatiles();
+        }
         m_nodes_provider = input::NodesProviderFactory::db_provider(config, column_config_parser, std::move(nodes_table), std::move(untagged_nodes_table));
     } else {
         m_nodes_provider = input::NodesProviderFactory::flatnodes_provider(config, column_config_parser, std::move(nodes_table));
@@ -46,6 +60,7 @@ input::CerepsoDataAccess::CerepsoDataAccess(VectortileGeneratorConfig& config,
 input::CerepsoDataAccess::CerepsoDataAccess(CerepsoDataAccess&& other) :
     m_column_config_parser(other.m_column_config_parser),
     m_config(other.m_config),
+    m_connection_manager(std::move(other.m_connection_manager)),
     m_nodes_provider(std::move(other.m_nodes_provider)),
     m_ways_table(std::move(other.m_ways_table)),
     m_relations_table(std::move(other.m_relations_table)),
@@ -60,43 +75,68 @@ input::CerepsoDataAccess::CerepsoDataAccess(CerepsoDataAccess&& other) :
 
 void input::CerepsoDataAccess::create_prepared_statements() {
     // ways
+    std::string intersects = "ST_INTERSECTS(geom, %1%)";
     std::string query = m_metadata_fields.select_str();
-    query += " osm_id, tags";
-    query.append(" FROM %1% WHERE ST_INTERSECTS(geom, ST_MakeEnvelope($1, $2, $3, $4, 4326))");
-    query = (boost::format(query) % m_ways_table.get_name()).str();
-    m_ways_table.create_prepared_statement("get_ways", query, 4);
+    query += " osm_id::bigint, tags::text %1%";
+    query.append(" FROM %2% WHERE %3%");
+    query = (boost::format(query) % m_ways_table.tile_mask_column(intersects) % m_ways_table.get_name()
+            % OSMDataTable::bbox_condition(intersects)).str();
+    m_ways_table.create_prepared_statement("get_ways", query, m_ways_table.bbox_parameter_count(), ResultFormat::BINARY);
 
     query = m_metadata_fields.select_str();
-    query += " tags";
-    query.append(" FROM %1% WHERE osm_id = $1");
+    query += " osm_id::bigint, tags::text";
+    query.append(" FROM %1% WHERE osm_id = ANY($1::bigint[])");
     query = (boost::format(query) % m_ways_table.get_name()).str();
-    m_ways_table.create_prepared_statement("get_single_way", query, 1);
+    m_ways_table.create_prepared_statement("get_ways_by_ids", query, 1, ResultFormat::BINARY);
 
-    query = (boost::format("SELECT node_id, position FROM %1% WHERE way_id = $1")
-        % m_node_ways_table.get_name()).str();
-    m_node_ways_table.create_prepared_statement("get_way_nodes", query, 1);
+    query = (boost::format("SELECT way_id::bigint, node_id::bigint, position::integer FROM %1%" \
+            " WHERE way_id = ANY($1::bigint[]) ORDER BY way_id, position") % m_node_ways_table.get_name()).str();
+    m_node_ways_table.create_prepared_statement("get_way_nodes", query, 1, ResultFormat::BINARY);
 
     // relations
+    intersects = "(ST_INTERSECTS(geom_points, %1%) OR ST_INTERSECTS(geom_lines, %1%))";
     query = m_metadata_fields.select_str();
-    query += " osm_id, tags";
-    query.append(" FROM %1% WHERE ST_INTERSECTS(geom_points, " \
-            "ST_MakeEnvelope($1, $2, $3, $4, 4326)) OR ST_INTERSECTS(geom_lines, ST_MakeEnvelope($1, $2, $3, $4, 4326))");
-    query = (boost::format(query) % m_relations_table.get_name()).str();
-    m_relations_table.create_prepared_statement("get_relations", query, 4);
+    query += " osm_id::bigint, tags::text %1%";
+    query.append(" FROM %2% WHERE %3%");
+    query = (boost::format(query) % m_relations_table.tile_mask_column(intersects) % m_relations_table.get_name()
+            % OSMDataTable::bbox_condition(intersects)).str();
+    m_relations_table.create_prepared_statement("get_relations", query, m_relations_table.bbox_parameter_count(),
+            ResultFormat::BINARY);
+    if (m_config.m_precheck) {
+        m_ways_table.create_source_state_statement("ST_INTERSECTS(geom, %1%)");
+        m_relations_table.create_source_state_statement(intersects);
+    }
 
     query = m_metadata_fields.select_str();
-    query += " tags";
-    query.append(" FROM %1% WHERE osm_id = $1");
+    query += " osm_id::bigint, tags::text";
+    query.append(" FROM %1% WHERE osm_id = ANY($1::bigint[])");
     query = (boost::format(query) % m_relations_table.get_name()).str();
-    m_ways_table.create_prepared_statement("get_single_relation", query, 1);
+    m_relations_table.create_prepared_statement("get_relations_by_ids", query, 1, ResultFormat::BINARY);
+
+    // relations which are members of relations, see get_missing_relations()
+    query = (boost::format("SELECT DISTINCT member_id::bigint FROM %1% WHERE relation_id = ANY($1::bigint[])")
+            % m_relation_relations_table.get_name()).str();
+    m_relation_relations_table.create_prepared_statement("get_member_relations", query, 1, ResultFormat::BINARY);
 
-    std::string get_rel_members_template = "SELECT member_id, role, position FROM %1% WHERE relation_id = $1";
+    std::string get_rel_members_template = "SELECT relation_id::bigint, member_id::bigint, role::text," \
+            " position::integer FROM %1% WHERE relation_id = ANY($1::bigint[])";
     query = (boost::format(get_rel_members_template) % m_node_relations_table.get_name()).str();
-    m_node_relations_table.create_prepared_statement("get_relation_members", query, 1);
+    m_node_relations_table.create_prepared_statement("get_relation_members", query, 1, ResultFormat::BINARY);
     query = (boost::format(get_rel_members_template) % m_way_relations_table.get_name()).str();
-    m_way_relations_table.create_prepared_statement("get_relation_members", query, 1);
+    m_way_relations_table.create_prepared_statement("get_relation_members", query, 1, ResultFormat::BINARY);
     query = (boost::format(get_rel_members_template) % m_relation_relations_table.get_name()).str();
-    m_relation_relations_table.create_prepared_statement("get_relation_members", query, 1);
+    m_relation_relations_table.create_prepared_statement("get_relation_members", query, 1, ResultFormat::BINARY);
+}
+
+PGconn* input::CerepsoDataAccess::connection(const size_t slot) {
+    if (m_config.m_async_queries) {
+        return m_connection_manager->get(slot);
+    }
+    // Member tables are queried while results of the tables queried by bounding box are streamed.
+    if (m_config.m_chunk_size > 0 && slot == MEMBERS_SLOT) {
+        return m_connection_manager->get(MEMBERS_SLOT);
+    }
+    return m_connection_manager->get(NODES_SLOT);
 }
 
 void input::CerepsoDataAccess::set_bbox(const BoundingBox& bbox) {
@@ -105,6 +145,32 @@ void input::CerepsoDataAccess::set_bbox(const BoundingBox& bbox) {
     m_relations_table.set_bbox(bbox);
 }
 
+void input::CerepsoDataAccess::set_metatile(const Metatile& metatile) {
+    m_nodes_provider->set_metatile(metatile);
+    m_ways_table.set_metatile(metatile);
+    m_relations_table.set_metatile(metatile);
+}
+
+void input::CerepsoDataAccess::set_latency_callback(OSMDataTable::latency_callback_type callback) {
+    m_nodes_provider->set_latency_callback(callback);
+    m_ways_table.set_latency_callback(callback);
+    m_relations_table.set_latency_callback(callback);
+}
+
+std::string input::CerepsoDataAccess::source_state(const BoundingBox& bbox) {
+    std::string state = m_nodes_provider->source_state(bbox);
+    state.push_back(',');
+    state += m_ways_table.source_state(bbox);
+    state.push_back(',');
+    state += m_relations_table.source_state(bbox);
+    return state;
+}
+
+double input::CerepsoDataAccess::estimate_rows(const BoundingBox& bbox) {
+    return m_nodes_provider->estimate_rows(bbox) + m_ways_table.estimate_rows("get_ways", bbox)
+            + m_relations_table.estimate_rows("get_relations", bbox);
+}
+
 void input::CerepsoDataAccess::set_add_node_callback(osm_vector_tile_impl::node_callback_type&& callback,
         osm_vector_tile_impl::node_without_tags_callback_type&& callback_without_tags,
         osm_vector_tile_impl::simple_node_callback_type&& simple_callback) {
@@ -123,6 +189,41 @@ void input::CerepsoDataAccess::set_add_relation_callback(osm_vector_tile_impl::r
     m_add_relation_callback = callback;
 }
 
+/*static*/ void input::CerepsoDataAccess::parse_relation_members(PGresult* result,
+        const osmium::item_type type, relation_members_map_type& members) {
+    int tuple_count = PQntuples(result);
+    for (int i = 0; i < tuple_count; ++i) {
+        osmium::object_id_type relation_id = binary_result::get_int8(result, i, 0);
+        osmium::object_id_type ref = binary_result::get_int8(result, i, 1);
+        std::string role = binary_result::get_text(result, i, 2);
+        int pos = binary_result::get_int4(result, i, 3);
+        members[relation_id].emplace_back(ref, type, std::move(role), pos);
+    }
+}
+
+input::CerepsoDataAccess::relation_members_map_type input::CerepsoDataAccess::get_relation_members(
+        const std::vector<osmium::object_id_type>& relation_ids) {
+    relation_members_map_type members;
+    members.reserve(relation_ids.size());
+    // The member tables share a connection. Their queries are pipelined if the server supports it.
+    std::vector<OSMDataTable::IdArrayQuery> queries {
+        {m_node_relations_table, "get_relation_members", relation_ids, [&](PGresult* result) {
+            parse_relation_members(result, osmium::item_type::node, members);
+        }},
+        {m_way_relations_table, "get_relation_members", relation_ids, [&](PGresult* result) {
+            parse_relation_members(result, osmium::item_type::way, members);
+        }},
+        {m_relation_relations_table, "get_relation_members", relation_ids, [&](PGresult* result) {
+            parse_relation_members(result, osmium::item_type::relation, members);
+        }}
+    };
+    OSMDataTable::run_prepared_id_array_statements(queries);
+    for (auto& m : members) {
+        std::sort(m.second.begin(), m.second.end());
+    }
+    return members;
+}
+
 void input::CerepsoDataAccess::parse_relation_query_result(PGresult* result, const osmium::object_id_type id) {
     int id_field_offset = m_metadata_fields.count();
     int tags_field_offset = id_field_offset;
@@ -133,65 +234,51 @@ void input::CerepsoDataAccess::parse_relation_query_result(PGresult* result, con
     int tuple_count = PQntuples(result);
     postgres_drivers::ColumnsVector& columns = m_column_config_parser.polygon_columns();
     std::vector<const char*> additional_values {columns.size(), nullptr};
+    input::BinaryMetadataValues metadata;
+
+    // get members of all relations with one query per member table and batch
+    std::vector<osmium::object_id_type> relation_ids;
+    relation_ids.reserve(tuple_count);
+    for (int i = 0; i < tuple_count; i++) {
+        relation_ids.push_back((id == 0) ? binary_result::get_int8(result, i, id_field_offset) : id);
+    }
+    relation_members_map_type relation_members = get_relation_members(relation_ids);
+
     for (int i = 0; i < tuple_count; i++) { // for each returned row
-        std::string tags_hstore = PQgetvalue(result, i, tags_field_offset);
-        const osmium::object_id_type osm_id = (id == 0) ? strtoll(PQgetvalue(result, i, id_field_offset), nullptr, 10) : id;
-        const char* version = m_metadata_fields.has_version() ? PQgetvalue(result, i, m_metadata_fields.version()) : nullptr;
-        const char* uid = m_metadata_fields.has_uid() ? PQgetvalue(result, i, m_metadata_fields.uid()) : nullptr;
-        const char* timestamp = m_metadata_fields.has_last_modified() ? PQgetvalue(result, i, m_metadata_fields.last_modified()) : nullptr;
-        const char* changeset = m_metadata_fields.has_changeset() ? PQgetvalue(result, i, m_metadata_fields.changeset()) : nullptr;
+        std::string tags_hstore = binary_result::get_text(result, i, tags_field_offset);
+        const osmium::object_id_type osm_id = relation_ids[i];
+        metadata.read(m_metadata_fields, result, i);
         for (size_t j = 0; j < columns.size(); ++j) {
-            additional_values[j] = PQgetvalue(result, i, additional_values_offset + j);
+            additional_values[j] = binary_result::get_text(result, i, additional_values_offset + j);
         }
-        // get nodes of this relation
-        char* param_values[1];
-        char param[25];
-        param_values[0] = param;
-        sprintf(param, "%ld", osm_id);
-        PGresult* result_members = m_node_relations_table.run_prepared_statement("get_relation_members", 1, param_values);
         std::vector<osm_vector_tile_impl::MemberIdRoleTypePos> members;
-        int tuples = PQntuples(result_members);
-        for (int j = 0; j < tuples; ++j) {
-            osmium::object_id_type ref = strtoll(PQgetvalue(result_members, j, 0), nullptr, 10);
-            std::string role = PQgetvalue(result_members, j, 1);
-            int pos = atoi(PQgetvalue(result_members, j, 2));
-            members.emplace_back(ref, osmium::item_type::node, std::move(role), pos);
+        auto members_it = relation_members.find(osm_id);
+        if (members_it != relation_members.end()) {
+            members = std::move(members_it->second);
         }
-        PQclear(result_members);
-        result_members = m_way_relations_table.run_prepared_statement("get_relation_members", 1, param_values);
-        tuples = PQntuples(result_members);
-        for (int j = 0; j < tuples; ++j) {
-            osmium::object_id_type ref = strtoll(PQgetvalue(result_members, j, 0), nullptr, 10);
-            std::string role = PQgetvalue(result_members, j, 1);
-            int pos = atoi(PQgetvalue(result_members, j, 2));
-            members.emplace_back(ref, osmium::item_type::way, std::move(role), pos);
-        }
-        PQclear(result_members);
-        result_members = m_relation_relations_table.run_prepared_statement("get_relation_members", 1, param_values);
-        tuples = PQntuples(result_members);
-        for (int j = 0; j < tuples; ++j) {
-            osmium::object_id_type ref = strtoll(PQgetvalue(result_members, j, 0), nullptr, 10);
-            std::string role = PQgetvalue(result_members, j, 1);
-            int pos = atoi(PQgetvalue(result_members, j, 2));
-            members.emplace_back(ref, osmium::item_type::relation, std::move(role), pos);
-        }
-        std::sort(members.begin(), members.end());
-        m_add_relation_callback(osm_id, std::move(members), version, changeset, uid, timestamp,
+        m_add_relation_callback(osm_id, std::move(members), metadata.version, metadata.changeset, metadata.uid, metadata.timestamp,
                 std::move(tags_hstore), columns, additional_values);
     }
 }
 
 void input::CerepsoDataAccess::get_missing_relations(const osm_vector_tile_impl::osm_id_set_type& missing_relations) {
-    char* param_values[1];
-    char param[25];
-    param_values[0] = param;
-    for (const auto id : missing_relations) {
-        sprintf(param, "%ld", id);
-        PGresult* result = m_ways_table.run_prepared_statement("get_single_relation", 1, param_values);
-        parse_relation_query_result(result, id);
-        PQclear(result);
+    if (missing_relations.empty()) {
+        return;
     }
-//    m_buffer.commit();
+    std::vector<osmium::object_id_type> ids = relation_closure({missing_relations.begin(), missing_relations.end()},
+            m_config.m_max_relation_depth, [&](const std::vector<osmium::object_id_type>& relations,
+            std::vector<osmium::object_id_type>& members) {
+        m_relation_relations_table.run_prepared_id_array_statement("get_member_relations", relations,
+                [&](PGresult* result) {
+            int tuple_count = PQntuples(result);
+            for (int i = 0; i < tuple_count; ++i) {
+                members.push_back(binary_result::get_int8(result, i, 0));
+            }
+        });
+    });
+    m_relations_table.run_prepared_id_array_statement("get_relations_by_ids", ids, [&](PGresult* result) {
+        parse_relation_query_result(result, 0);
+    });
 }
 
 void input::CerepsoDataAccess::get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes) {
@@ -202,6 +289,28 @@ void input::CerepsoDataAccess::get_nodes_inside() {
     m_nodes_provider->get_nodes_inside();
 }
 
+input::CerepsoDataAccess::way_nodes_map_type input::CerepsoDataAccess::get_way_nodes(
+        const std::vector<osmium::object_id_type>& way_ids) {
+    way_nodes_map_type way_nodes;
+    way_nodes.reserve(way_ids.size());
+    m_node_ways_table.run_prepared_id_array_statement("get_way_nodes", way_ids, [&](PGresult* result) {
+        int tuple_count = PQntuples(result);
+        // The result is ordered by way ID and position. Therefore, we only have to look up the
+        // node list if the way ID changes.
+        osmium::object_id_type last_way_id = 0;
+        std::vector<postgres_drivers::MemberIdPos>* node_ids = nullptr;
+        for (int i = 0; i < tuple_count; ++i) {
+            osmium::object_id_type way_id = binary_result::get_int8(result, i, 0);
+            if (!node_ids || way_id != last_way_id) {
+                node_ids = &(way_nodes[way_id]);
+                last_way_id = way_id;
+            }
+            node_ids->emplace_back(binary_result::get_int8(result, i, 1), binary_result::get_int4(result, i, 2));
+        }
+    });
+    return way_nodes;
+}
+
 void input::CerepsoDataAccess::parse_way_query_result(PGresult* result, const osmium::object_id_type id) {
     int id_field_offset = m_metadata_fields.count();
     int tags_field_offset = id_field_offset;
@@ -212,60 +321,77 @@ void input::CerepsoDataAccess::parse_way_query_result(PGresult* result, const os
     int tuple_count = PQntuples(result);
     postgres_drivers::ColumnsVector& columns = m_column_config_parser.polygon_columns();
     std::vector<const char*> additional_values {columns.size(), nullptr};
+    input::BinaryMetadataValues metadata;
+
+    // get nodes of all ways with one query per batch
+    std::vector<osmium::object_id_type> way_ids;
+    way_ids.reserve(tuple_count);
+    for (int i = 0; i < tuple_count; i++) {
+        way_ids.push_back((id == 0) ? binary_result::get_int8(result, i, id_field_offset) : id);
+    }
+    way_nodes_map_type way_nodes = get_way_nodes(way_ids);
+
     for (int i = 0; i < tuple_count; i++) { // for each returned row
-        std::string tags_hstore = PQgetvalue(result, i, tags_field_offset);
-        osmium::object_id_type way_id = id;
-        if (id == 0) {
-            way_id = strtoll(PQgetvalue(result, i, id_field_offset), nullptr, 10);
-        }
-        const char* version = m_metadata_fields.has_version() ? PQgetvalue(result, i, m_metadata_fields.version()) : nullptr;
-        const char* uid = m_metadata_fields.has_uid() ? PQgetvalue(result, i, m_metadata_fields.uid()) : nullptr;
-        const char* timestamp = m_metadata_fields.has_last_modified() ? PQgetvalue(result, i, m_metadata_fields.last_modified()) : nullptr;
-        const char* changeset = m_metadata_fields.has_changeset() ? PQgetvalue(result, i, m_metadata_fields.changeset()) : nullptr;
+        std::string tags_hstore = binary_result::get_text(result, i, tags_field_offset);
+        osmium::object_id_type way_id = way_ids[i];
+        metadata.read(m_metadata_fields, result, i);
         for (size_t j = 0; j < columns.size(); ++j) {
-            additional_values[j] = PQgetvalue(result, i, additional_values_offset + j);
+            additional_values[j] = binary_result::get_text(result, i, additional_values_offset + j);
         }
-
-        // get nodes of this way
-        char* param_values[1];
-        char param[25];
-        param_values[0] = param;
-        sprintf(param, "%ld", way_id);
-        PGresult* result_member_nodes = m_node_ways_table.run_prepared_statement("get_way_nodes", 1, param_values);
         std::vector<postgres_drivers::MemberIdPos> node_ids;
-        int node_ways_tuples = PQntuples(result_member_nodes);
-        for (int j = 0; j < node_ways_tuples; ++j) {
-            node_ids.emplace_back(strtoll(PQgetvalue(result_member_nodes, j, 0), nullptr, 10), atoi(PQgetvalue(result_member_nodes, j, 1)));
+        auto nodes_it = way_nodes.find(way_id);
+        if (nodes_it != way_nodes.end()) {
+            node_ids = std::move(nodes_it->second);
         }
-        std::sort(node_ids.begin(), node_ids.end());
-        PQclear(result_member_nodes);
-        m_add_way_callback(way_id, std::move(node_ids), version, changeset, uid, timestamp,
+        m_add_way_callback(way_id, std::move(node_ids), metadata.version, metadata.changeset, metadata.uid, metadata.timestamp,
                 std::move(tags_hstore), columns, additional_values);
     }
 }
 
 void input::CerepsoDataAccess::get_ways_inside() {
-    PGresult* result = m_ways_table.run_prepared_bbox_statement("get_ways");
-    parse_way_query_result(result, 0);
-    PQclear(result);
+    m_ways_table.run_prepared_bbox_statement("get_ways", [&](PGresult* result) {
+        parse_way_query_result(result, 0);
+    });
 }
 
 void input::CerepsoDataAccess::get_missing_ways(const osm_vector_tile_impl::osm_id_set_type& missing_ways) {
-    char* param_values[1];
-    char param[25];
-    param_values[0] = param;
-    for (const osmium::object_id_type id : missing_ways) {
-        sprintf(param, "%ld", id);
-        PGresult* result = m_ways_table.run_prepared_statement("get_single_way", 1, param_values);
-        parse_way_query_result(result, id);
-        PQclear(result);
-    }
+    std::vector<osmium::object_id_type> ids {missing_ways.begin(), missing_ways.end()};
+    m_ways_table.run_prepared_id_array_statement("get_ways_by_ids", ids, [&](PGresult* result) {
+        parse_way_query_result(result, 0);
+    });
 }
 
 void input::CerepsoDataAccess::get_relations_inside() {
-    PGresult* result = m_relations_table.run_prepared_bbox_statement("get_relations");
-    parse_relation_query_result(result, 0);
-    PQclear(result);
+    m_relations_table.run_prepared_bbox_statement("get_relations", [&](PGresult* result) {
+        parse_relation_query_result(result, 0);
+    });
+}
+
+void input::CerepsoDataAccess::get_objects_inside() {
+    assert(m_config.m_async_queries);
+    m_nodes_provider->send_nodes_inside();
+    m_ways_table.send_prepared_bbox_statement("get_ways");
+    m_relations_table.send_prepared_bbox_statement("get_relations");
+    // Nodes have to be processed before ways and ways before relations because the callbacks
+    // check which referenced objects are missing.
+    try {
+        m_nodes_provider->receive_nodes_inside();
+    } catch (...) {
+        m_ways_table.cancel_and_discard_results();
+        m_relations_table.cancel_and_discard_results();
+        throw;
+    }
+    try {
+        m_ways_table.receive_results([&](PGresult* result) {
+            parse_way_query_result(result, 0);
+        });
+    } catch (...) {
+        m_relations_table.cancel_and_discard_results();
+        throw;
+    }
+    m_relations_table.receive_results([&](PGresult* result) {
+        parse_relation_query_result(result, 0);
+    });
 }
 
 
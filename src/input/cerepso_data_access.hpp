@@ -11,6 +11,8 @@
 #include <libpq-fe.h>
 #include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/types.hpp>
@@ -18,6 +20,7 @@
 #include "nodes_provider.hpp"
 #include "metadata_fields.hpp"
 #include "column_config_parser.hpp"
+#include "../connection_manager.hpp"
 #include "../osm_data_table.hpp"
 #include "../osm_vector_tile_impl_definitions.hpp"
 #include "../vectortile_generator_config.hpp"
@@ -30,10 +33,30 @@ namespace input {
      */
     class CerepsoDataAccess {
 
+        /// node lists of multiple ways (node IDs and their positions), key is the way ID
+        using way_nodes_map_type = std::unordered_map<osmium::object_id_type, std::vector<postgres_drivers::MemberIdPos>>;
+
+        /// members of multiple relations, key is the relation ID
+        using relation_members_map_type = std::unordered_map<osmium::object_id_type, std::vector<osm_vector_tile_impl::MemberIdRoleTypePos>>;
+
         input::ColumnConfigParser& m_column_config_parser;
 
         VectortileGeneratorConfig& m_config;
 
+        /// connection slot of the tables of nodes
+        static constexpr size_t NODES_SLOT = 0;
+        /// connection slot of the member tables which are queried while the results of other tables are pending
+        static constexpr size_t MEMBERS_SLOT = 1;
+        /// connection slot of the ways table
+        static constexpr size_t WAYS_SLOT = 2;
+        /// connection slot of the relations table
+        static constexpr size_t RELATIONS_SLOT = 3;
+        /// connection slot of the untagged nodes table
+        static constexpr size_t UNTAGGED_NODES_SLOT = 4;
+
+        /// database connections shared by all tables
+        std::unique_ptr<ConnectionManager> m_connection_manager;
+
         /// providing `nodes` and `untagged_nodes` table
         std::unique_ptr<input::NodesProvider> m_nodes_provider;
         /// `ways` table
@@ -64,9 +87,46 @@ namespace input {
          */
         void create_prepared_statements();
 
+        /**
+         * \brief Get the node lists of a set of ways from the `node_ways` table.
+         *
+         * The IDs are queried in batches of up to OSMDataTable::ID_ARRAY_BATCH_SIZE IDs
+         * using one query per batch instead of one query per way.
+         *
+         * \param way_ids IDs of the ways
+         *
+         * \returns node lists sorted by position, ways without nodes are missing
+         */
+        way_nodes_map_type get_way_nodes(const std::vector<osmium::object_id_type>& way_ids);
+
+        /**
+         * \brief Parse the response of one of the member tables and append the members to the
+         * member lists.
+         *
+         * \param result query result
+         * \param type type of the members stored in the queried table
+         * \param members member lists to append the members to
+         */
+        static void parse_relation_members(PGresult* result, const osmium::item_type type,
+                relation_members_map_type& members);
+
+        /**
+         * \brief Get the members of a set of relations from all member tables.
+         *
+         * Each member table is queried once per batch of up to OSMDataTable::ID_ARRAY_BATCH_SIZE IDs
+         * instead of once per relation. The queries are pipelined if supported.
+         *
+         * \param relation_ids IDs of the relations
+         *
+         * \returns member lists sorted by position, relations without members are missing
+         */
+        relation_members_map_type get_relation_members(const std::vector<osmium::object_id_type>& relation_ids);
+
         /**
          * \brief Parse the response of the database after querying ways
          *
+         * The query result has to be in binary format.
+         *
          * Does not clean up memory afterwards!
          *
          * \param result query result
@@ -77,6 +137,8 @@ namespace input {
         /**
          * \brief Parse the response of the database after querying relations
          *
+         * The query result has to be in binary format.
+         *
          * Does not clean up memory afterwards!
          *
          * \param result query result
@@ -85,7 +147,18 @@ namespace input {
         void parse_relation_query_result(PGresult* result, osmium::object_id_type id);
 
         static OSMDataTable build_table(const char* name, VectortileGeneratorConfig& config,
-                postgres_drivers::TableType type, postgres_drivers::ColumnsVector* additional_columns);
+                PGconn* connection, postgres_drivers::TableType type,
+                postgres_drivers::ColumnsVector* additional_columns);
+
+        /**
+         * \brief Get the connection of a slot.
+         *
+         * Each slot has its own connection if queries are sent asynchronously. If results are streamed,
+         * the member tables have their own connection. Otherwise, all tables share one connection.
+         *
+         * \param slot one of the *_SLOT constants
+         */
+        PGconn* connection(const size_t slot);
 
     public:
         CerepsoDataAccess(VectortileGeneratorConfig& config,
@@ -95,6 +168,46 @@ namespace input {
 
         void set_bbox(const BoundingBox& bbox);
 
+        /**
+         * \brief Set the metatile whose data is queried by spatial queries.
+         *
+         * Select the tile to build using set_bbox() afterwards. Metatiles have to be enabled
+         * in the configuration.
+         */
+        void set_metatile(const Metatile& metatile);
+
+        /**
+         * \brief Set a callback receiving the latency of spatial queries, see OSMDataTable::set_latency_callback().
+         */
+        void set_latency_callback(OSMDataTable::latency_callback_type callback);
+
+        /**
+         * \brief Summarize the rows of a tile in all tables queried by spatial queries.
+         *
+         * The result changes if rows of the tile are added, removed or modified (assuming that
+         * modified rows get a newer osm_lastmodified timestamp than all rows of the tile). Only rows
+         * inside the envelope of the tile are summarized. Nodes, ways and relations added to the
+         * tile because they are referenced by these rows are not.
+         *
+         * \param bbox bounding box of the tile
+         *
+         * \returns summary
+         *
+         * \throws std::runtime_error
+         */
+        std::string source_state(const BoundingBox& bbox);
+
+        /**
+         * \brief Estimate the number of rows returned by the spatial queries of a tile.
+         *
+         * The estimates of the query planner are used, the queries are not executed.
+         *
+         * \param bbox bounding box of the tile
+         *
+         * \throws std::runtime_error
+         */
+        double estimate_rows(const BoundingBox& bbox);
+
         void set_add_node_callback(osm_vector_tile_impl::node_callback_type&& callback,
                 osm_vector_tile_impl::node_without_tags_callback_type&& callback_without_tags,
                 osm_vector_tile_impl::simple_node_callback_type&& simple_callback);
@@ -106,7 +219,11 @@ namespace input {
                 osm_vector_tile_impl::slim_relation_callback_type&&);
 
         /**
-         * \brief Get all missing relations
+         * \brief Get all missing relations and all relations which are members of them (recursively)
+         *
+         * The members are resolved one nesting level after the other using relation_closure(),
+         * each relation is queried once. The nesting depth is limited by
+         * VectortileGeneratorConfig::m_max_relation_depth.
          *
          * \param missing_relations relations to fetch from the database
          */
@@ -143,6 +260,17 @@ namespace input {
          */
         void get_relations_inside();
 
+        /**
+         * \brief Get all nodes, ways and relations inside the tile.
+         *
+         * The spatial queries are sent at once on separate connections and their results are
+         * processed afterwards in the order nodes, ways, relations. This requires asynchronous
+         * queries to be enabled in the configuration.
+         *
+         * \throws std::runtime_error
+         */
+        void get_objects_inside();
+
     };
 
 } // namespace input
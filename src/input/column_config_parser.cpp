@@ -54,6 +54,16 @@ std::vector<input::ColumnConfigFlag> input::ColumnConfigParser::parse_flags(cons
     return postgres_drivers::ColumnType::NONE;
 }
 
+/*static*/ std::string input::ColumnConfigParser::select_as_text(const postgres_drivers::ColumnsVector& columns) {
+    std::string result;
+    for (auto& c : columns) {
+        result += ", \"";
+        result += c.name();
+        result += "\"::text";
+    }
+    return result;
+}
+
 void input::ColumnConfigParser::parse() {
     if (m_config.m_osm2pgsql_style.empty()) {
         return;
@@ -57,6 +57,18 @@ namespace input {
 
         static postgres_drivers::ColumnType str_to_column_type(const std::string& type);
 
+        /**
+         * \brief Get a list of columns for a SELECT query. Each column is casted to text.
+         *
+         * This is necessary if a query returns its result in binary format because the values
+         * of these columns are passed as strings.
+         *
+         * \param columns columns to select
+         *
+         * \returns comma separated list of columns with a leading comma
+         */
+        static std::string select_as_text(const postgres_drivers::ColumnsVector& columns);
+
         void parse();
 
         postgres_drivers::ColumnsVector& point_columns();
@@ -6,6 +6,9 @@
  */
 
 #include "metadata_fields.hpp"
+#include <inttypes.h>
+#include <stdio.h>
+#include "../binary_result.hpp"
 
 input::MetadataFields::MetadataFields(VectortileGeneratorConfig& config) :
     m_metadata_field_count(0),
@@ -52,7 +55,7 @@ int input::MetadataFields::last_modified() {
     return m_last_modified_index;
 }
 
-bool input::MetadataFields::changeset() {
+int input::MetadataFields::changeset() {
     return m_changeset_index;
 }
 
@@ -82,19 +85,50 @@ bool input::MetadataFields::has_changeset() {
 std::string input::MetadataFields::select_str() const {
     std::string query = "SELECT ";
     if (m_config.m_postgres_config.metadata.user()) {
-        query.append("osm_user, ");
+        query.append("osm_user::text, ");
     }
     if (m_config.m_postgres_config.metadata.uid()) {
-        query.append("osm_uid, ");
+        query.append("osm_uid::bigint, ");
     }
     if (m_config.m_postgres_config.metadata.version()) {
-        query.append("osm_version, ");
+        query.append("osm_version::integer, ");
     }
     if (m_config.m_postgres_config.metadata.timestamp()) {
-        query.append("osm_lastmodified, ");
+        query.append("osm_lastmodified::text, ");
     }
     if (m_config.m_postgres_config.metadata.changeset()) {
-        query.append("osm_changeset, ");
+        query.append("osm_changeset::bigint, ");
     }
     return query;
 }
+
+void input::BinaryMetadataValues::read(MetadataFields& fields, const PGresult* result, const int row) {
+    // NULL values are returned as empty strings like PQgetvalue() does for results in text format.
+    if (fields.has_user()) {
+        user = binary_result::get_text(result, row, fields.user());
+    }
+    if (fields.has_uid()) {
+        m_uid[0] = '\0';
+        if (!binary_result::is_null(result, row, fields.uid())) {
+            snprintf(m_uid, sizeof(m_uid), "%" PRId64, binary_result::get_int8(result, row, fields.uid()));
+        }
+        uid = m_uid;
+    }
+    if (fields.has_version()) {
+        m_version[0] = '\0';
+        if (!binary_result::is_null(result, row, fields.version())) {
+            snprintf(m_version, sizeof(m_version), "%" PRId32, binary_result::get_int4(result, row, fields.version()));
+        }
+        version = m_version;
+    }
+    if (fields.has_last_modified()) {
+        timestamp = binary_result::get_text(result, row, fields.last_modified());
+    }
+    if (fields.has_changeset()) {
+        m_changeset[0] = '\0';
+        if (!binary_result::is_null(result, row, fields.changeset())) {
+            snprintf(m_changeset, sizeof(m_changeset), "%" PRId64, binary_result::get_int8(result, row, fields.changeset()));
+        }
+        changeset = m_changeset;
+    }
+}
@@ -8,6 +8,7 @@
 #ifndef SRC_INPUT_CEREPSO_METADATA_FIELDS_HPP_
 #define SRC_INPUT_CEREPSO_METADATA_FIELDS_HPP_
 
+#include <libpq-fe.h>
 #include <string>
 #include "../vectortile_generator_config.hpp"
 
@@ -39,7 +40,7 @@ namespace input {
 
         int last_modified();
 
-        bool changeset();
+        int changeset();
 
         bool has_user();
 
@@ -53,10 +54,43 @@ namespace input {
 
         /**
          * Get the beginning of an SQL SELECT string containing all requested metadata fields.
+         *
+         * The fields are casted to the types expected by BinaryMetadataValues.
          */
         std::string select_str() const;
     };
 
+    /**
+     * \brief Metadata of one row of a query result in binary format
+     *
+     * The values are converted to the null-terminated strings expected by the callbacks of
+     * OSMVectorTileImpl. Fields which were not requested are null pointers.
+     */
+    class BinaryMetadataValues {
+        char m_uid[21];
+        char m_version[12];
+        char m_changeset[21];
+
+    public:
+        const char* user = nullptr;
+        const char* uid = nullptr;
+        const char* version = nullptr;
+        const char* timestamp = nullptr;
+        const char* changeset = nullptr;
+
+        /**
+         * \brief Read the metadata fields of a row.
+         *
+         * The pointers stay valid until the next call of this method or until the query result is
+         * cleared, whatever happens first.
+         *
+         * \param fields column indexes of the metadata fields
+         * \param result query result in binary format
+         * \param row row index
+         */
+        void read(MetadataFields& fields, const PGresult* result, const int row);
+    };
+
 } // namespace input
 
 
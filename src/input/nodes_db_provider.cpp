@@ -22,27 +22,34 @@ input::NodesDBProvider::~NodesDBProvider() {
 }
 
 void input::NodesDBProvider::create_prepared_statements_untagged() {
-    std::string query = m_metadata.select_str();
+    std::string query;
     // retrieval of untagged nodes by location is not possible without a geometry column
     if (m_config.m_untagged_nodes_geom) {
         std::string geom_column_name = m_nodes_table.get_column_name_by_type(postgres_drivers::ColumnType::POINT);
+        std::string intersects = (boost::format("ST_INTERSECTS(%1%, %%1%%)") % geom_column_name).str();
         query = m_metadata.select_str();
-        query += " osm_id, ST_X(%1%), ST_Y(%1%)";
-        query.append(" FROM %2% WHERE ST_INTERSECTS(%1%, ST_MakeEnvelope($1, $2, $3, $4, 4326))");
-        query = (boost::format(query) % geom_column_name % m_untagged_nodes_table.get_name()).str();
-        m_nodes_table.create_prepared_statement("get_nodes_without_tags", query, 1);
+        query += " osm_id::bigint, %1% %2%";
+        query.append(" FROM %3% WHERE %4%");
+        query = (boost::format(query) % geom_column_name % m_untagged_nodes_table.tile_mask_column(intersects)
+                % m_untagged_nodes_table.get_name() % OSMDataTable::bbox_condition(intersects)).str();
+        m_untagged_nodes_table.create_prepared_statement("get_nodes_without_tags", query,
+                m_untagged_nodes_table.bbox_parameter_count(), ResultFormat::BINARY);
 
         query = m_metadata.select_str();
-        query += " ST_X(%1%), ST_Y(%1%)";
-        query.append(" FROM %2% WHERE osm_id = $1");
+        query += " osm_id::bigint, %1%";
+        query.append(" FROM %2% WHERE osm_id = ANY($1::bigint[])");
         query = (boost::format(query) % geom_column_name % m_untagged_nodes_table.get_name()).str();
+
+        if (m_config.m_precheck) {
+            m_untagged_nodes_table.create_source_state_statement(intersects);
+        }
     } else {
         query = m_metadata.select_str();
-        query += " x, y";
-        query.append(" FROM %1% WHERE osm_id = $1");
+        query += " osm_id::bigint, x::integer, y::integer";
+        query.append(" FROM %1% WHERE osm_id = ANY($1::bigint[])");
         query = (boost::format(query) % m_untagged_nodes_table.get_name()).str();
     }
-    m_untagged_nodes_table.create_prepared_statement("get_single_node_without_tags", query, 1);
+    m_untagged_nodes_table.create_prepared_statement("get_nodes_without_tags_by_ids", query, 1, ResultFormat::BINARY);
 }
 
 void input::NodesDBProvider::set_bbox(const BoundingBox& bbox) {
@@ -50,28 +57,76 @@ void input::NodesDBProvider::set_bbox(const BoundingBox& bbox) {
     m_untagged_nodes_table.set_bbox(bbox);
 }
 
+void input::NodesDBProvider::set_metatile(const Metatile& metatile) {
+    NodesProvider::set_metatile(metatile);
+    m_untagged_nodes_table.set_metatile(metatile);
+}
+
+void input::NodesDBProvider::set_latency_callback(OSMDataTable::latency_callback_type callback) {
+    NodesProvider::set_latency_callback(callback);
+    m_untagged_nodes_table.set_latency_callback(callback);
+}
+
+std::string input::NodesDBProvider::source_state(const BoundingBox& bbox) {
+    std::string state = NodesProvider::source_state(bbox);
+    if (m_config.m_untagged_nodes_geom) {
+        state.push_back(',');
+        state += m_untagged_nodes_table.source_state(bbox);
+    }
+    return state;
+}
+
+double input::NodesDBProvider::estimate_rows(const BoundingBox& bbox) {
+    double rows = NodesProvider::estimate_rows(bbox);
+    if (m_config.m_orphaned_nodes && m_config.m_untagged_nodes_geom) {
+        rows += m_untagged_nodes_table.estimate_rows("get_nodes_without_tags", bbox);
+    }
+    return rows;
+}
+
 void input::NodesDBProvider::get_nodes_inside() {
     NodesProvider::get_nodes_inside();
     if (m_config.m_orphaned_nodes) { // If requested by the user, query untagged nodes table, too.
-        PGresult* result = m_untagged_nodes_table.run_prepared_bbox_statement("get_nodes_without_tags");
-        parse_node_query_result(result, false, 0);
-        PQclear(result);
+        m_untagged_nodes_table.run_prepared_bbox_statement("get_nodes_without_tags", [&](PGresult* result) {
+            parse_node_query_result(result, false, 0);
+        });
     }
 }
 
-void input::NodesDBProvider::get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes) {
-    char* param_values[1];
-    char param[25];
-    param_values[0] = param;
-    for (const osmium::object_id_type id : missing_nodes) {
-        sprintf(param, "%ld", id);
-        PGresult* result = m_untagged_nodes_table.run_prepared_statement("get_single_node_without_tags", 1, param_values);
-        if (PQntuples(result) > 0) {
-            parse_node_query_result(result, false, id);
-            PQclear(result);
-            continue;
+void input::NodesDBProvider::send_nodes_inside() {
+    NodesProvider::send_nodes_inside();
+    if (m_config.m_orphaned_nodes) {
+        m_untagged_nodes_table.send_prepared_bbox_statement("get_nodes_without_tags");
+    }
+}
+
+void input::NodesDBProvider::cancel_nodes_inside() {
+    NodesProvider::cancel_nodes_inside();
+    if (m_config.m_orphaned_nodes) {
+        m_untagged_nodes_table.cancel_and_discard_results();
+    }
+}
+
+void input::NodesDBProvider::receive_nodes_inside() {
+    try {
+        NodesProvider::receive_nodes_inside();
+    } catch (...) {
+        if (m_config.m_orphaned_nodes) {
+            m_untagged_nodes_table.cancel_and_discard_results();
         }
-        PQclear(result);
-        get_node_with_tags(id, param_values);
+        throw;
+    }
+    if (m_config.m_orphaned_nodes) {
+        m_untagged_nodes_table.receive_results([&](PGresult* result) {
+            parse_node_query_result(result, false, 0);
+        });
     }
 }
+
+void input::NodesDBProvider::get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes) {
+    std::vector<osmium::object_id_type> ids {missing_nodes.begin(), missing_nodes.end()};
+    // Most missing nodes are untagged. Query the table of tagged nodes for the remaining ones only.
+    std::vector<osmium::object_id_type> not_found = get_nodes_by_ids(m_untagged_nodes_table,
+            "get_nodes_without_tags_by_ids", false, ids);
+    get_nodes_with_tags(not_found);
+}
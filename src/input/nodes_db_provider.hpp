@@ -36,8 +36,37 @@ namespace input {
 
         void set_bbox(const BoundingBox& bbox);
 
+        void set_metatile(const Metatile& metatile);
+
+        void set_latency_callback(OSMDataTable::latency_callback_type callback);
+
+        /**
+         * \brief Summarize the tagged and untagged nodes of a tile for change detection.
+         *
+         * The untagged nodes table is only included if it has a geometry column.
+         */
+        std::string source_state(const BoundingBox& bbox);
+
+        /**
+         * \brief Estimate the number of tagged and untagged nodes queried for a tile.
+         *
+         * The untagged nodes table is only included if it is queried (-O).
+         */
+        double estimate_rows(const BoundingBox& bbox);
+
         void get_nodes_inside();
 
+        /**
+         * \brief Send the spatial queries for tagged nodes and, if requested, untagged nodes.
+         *
+         * The tables of tagged and untagged nodes must use different database connections.
+         */
+        void send_nodes_inside();
+
+        void receive_nodes_inside();
+
+        void cancel_nodes_inside();
+
         void get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes);
     };
 
@@ -34,23 +34,27 @@ input::NodesFlatnodeProvider::~NodesFlatnodeProvider() {
 }
 
 void input::NodesFlatnodeProvider::get_nodes_inside() {
+    if (m_config.m_orphaned_nodes) { // If requested by the user, query untagged nodes table, too.
+        throw std::runtime_error{"Cannot query untagged nodes in the flatnodes file by bounding box."};
+    }
     NodesProvider::get_nodes_inside();
+}
+
+void input::NodesFlatnodeProvider::send_nodes_inside() {
     if (m_config.m_orphaned_nodes) { // If requested by the user, query untagged nodes table, too.
         throw std::runtime_error{"Cannot query untagged nodes in the flatnodes file by bounding box."};
     }
+    NodesProvider::send_nodes_inside();
 }
 
 void input::NodesFlatnodeProvider::get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes) {
-    char* param_values[1];
-    char param[25];
-    param_values[0] = param;
-    for (const osmium::object_id_type id : missing_nodes) {
-        sprintf(param, "%ld", id);
-        if (!get_node_with_tags(id, param_values)) {
-            osmium::Location location = m_location_handler.get_node_location(id);
-            if (location.valid()) {
-                m_add_simple_node_callback(id, location);
-            }
+    std::vector<osmium::object_id_type> ids {missing_nodes.begin(), missing_nodes.end()};
+    std::vector<osmium::object_id_type> not_found = get_nodes_with_tags(ids);
+    // The IDs are sorted. Lookups in the flatnodes file are done in ascending order.
+    for (const osmium::object_id_type id : not_found) {
+        osmium::Location location = m_location_handler.get_node_location(id);
+        if (location.valid()) {
+            m_add_simple_node_callback(id, location);
         }
     }
 }
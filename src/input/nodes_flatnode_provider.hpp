@@ -36,6 +36,8 @@ namespace input {
 
         void get_nodes_inside();
 
+        void send_nodes_inside();
+
         void get_missing_nodes(const osm_vector_tile_impl::osm_id_set_type& missing_nodes);
     };
 
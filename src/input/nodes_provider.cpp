@@ -6,6 +6,9 @@
  */
 
 #include "nodes_provider.hpp"
+#include "../binary_result.hpp"
+#include <algorithm>
+#include <iterator>
 #include <string>
 
 
@@ -37,39 +40,89 @@ void input::NodesProvider::set_bbox(const BoundingBox& bbox) {
     m_nodes_table.set_bbox(bbox);
 }
 
+void input::NodesProvider::set_metatile(const Metatile& metatile) {
+    m_nodes_table.set_metatile(metatile);
+}
+
+void input::NodesProvider::set_latency_callback(OSMDataTable::latency_callback_type callback) {
+    m_nodes_table.set_latency_callback(callback);
+}
+
 void input::NodesProvider::create_prepared_statements() {
     std::string geom_column_name = m_nodes_table.get_column_name_by_type(postgres_drivers::ColumnType::POINT);
-    std::string columns = postgres_drivers::join_columns_to_str(m_column_config_parser.point_columns(), true);
+    std::string columns = ColumnConfigParser::select_as_text(m_column_config_parser.point_columns());
+    std::string intersects = (boost::format("ST_INTERSECTS(%1%, %%1%%)") % geom_column_name).str();
     std::string query = m_metadata.select_str();
-    query += " osm_id, tags, ST_X(%1%), ST_Y(%1%) %2% FROM %3% WHERE ST_INTERSECTS(%1%, ST_MakeEnvelope($1, $2, $3, $4, 4326))";
-    query = (boost::format(query) % geom_column_name % columns % m_nodes_table.get_name()).str();
-    m_nodes_table.create_prepared_statement("get_nodes_with_tags", query, 4);
+    query += " osm_id::bigint, tags::text, %1% %2% %3% FROM %4% WHERE %5%";
+    query = (boost::format(query) % geom_column_name % columns % m_nodes_table.tile_mask_column(intersects)
+            % m_nodes_table.get_name() % OSMDataTable::bbox_condition(intersects)).str();
+    m_nodes_table.create_prepared_statement("get_nodes_with_tags", query, m_nodes_table.bbox_parameter_count(),
+            ResultFormat::BINARY);
 
     query = m_metadata.select_str();
-    query += " tags, ST_X(%1%), ST_Y(%1%) %2%";
-    query.append(" FROM %3% WHERE osm_id = $1");
+    query += " osm_id::bigint, tags::text, %1% %2%";
+    query.append(" FROM %3% WHERE osm_id = ANY($1::bigint[])");
     query = (boost::format(query) % geom_column_name % columns % m_nodes_table.get_name()).str();
-    m_nodes_table.create_prepared_statement("get_single_node_with_tags", query, 1);
+    m_nodes_table.create_prepared_statement("get_nodes_with_tags_by_ids", query, 1, ResultFormat::BINARY);
+
+    if (m_config.m_precheck) {
+        m_nodes_table.create_source_state_statement(intersects);
+    }
+}
+
+std::string input::NodesProvider::source_state(const BoundingBox& bbox) {
+    return m_nodes_table.source_state(bbox);
+}
+
+double input::NodesProvider::estimate_rows(const BoundingBox& bbox) {
+    return m_nodes_table.estimate_rows("get_nodes_with_tags", bbox);
 }
 
 void input::NodesProvider::get_nodes_inside() {
-    PGresult* result = m_nodes_table.run_prepared_bbox_statement("get_nodes_with_tags");
-    parse_node_query_result(result, true, 0);
-    PQclear(result);
+    m_nodes_table.run_prepared_bbox_statement("get_nodes_with_tags", [&](PGresult* result) {
+        parse_node_query_result(result, true, 0);
+    });
 }
 
-bool input::NodesProvider::get_node_with_tags(const osmium::object_id_type id, char** param_values) {
-    PGresult* result = m_nodes_table.run_prepared_statement("get_single_node_with_tags", 1, param_values);
-    if (PQntuples(result) > 0) {
-        parse_node_query_result(result, true, id);
-        PQclear(result);
-        return true;
-    }
-    PQclear(result);
-    return false;
+void input::NodesProvider::send_nodes_inside() {
+    m_nodes_table.send_prepared_bbox_statement("get_nodes_with_tags");
+}
+
+void input::NodesProvider::cancel_nodes_inside() {
+    m_nodes_table.cancel_and_discard_results();
+}
+
+void input::NodesProvider::receive_nodes_inside() {
+    m_nodes_table.receive_results([&](PGresult* result) {
+        parse_node_query_result(result, true, 0);
+    });
+}
+
+std::vector<osmium::object_id_type> input::NodesProvider::get_nodes_by_ids(OSMDataTable& table,
+        const char* prepared_statement_name, const bool with_tags,
+        const std::vector<osmium::object_id_type>& ids) {
+    std::vector<osmium::object_id_type> found;
+    found.reserve(ids.size());
+    const int id_field_offset = m_metadata.count();
+    table.run_prepared_id_array_statement(prepared_statement_name, ids, [&](PGresult* result) {
+        parse_node_query_result(result, with_tags, 0);
+        int tuple_count = PQntuples(result);
+        for (int i = 0; i < tuple_count; ++i) {
+            found.push_back(binary_result::get_int8(result, i, id_field_offset));
+        }
+    });
+    std::sort(found.begin(), found.end());
+    std::vector<osmium::object_id_type> not_found;
+    std::set_difference(ids.cbegin(), ids.cend(), found.cbegin(), found.cend(), std::back_inserter(not_found));
+    return not_found;
+}
+
+std::vector<osmium::object_id_type> input::NodesProvider::get_nodes_with_tags(
+        const std::vector<osmium::object_id_type>& ids) {
+    return get_nodes_by_ids(m_nodes_table, "get_nodes_with_tags_by_ids", true, ids);
 }
 
-/*static*/ void input::NodesProvider::parse_node_query_result(PGresult* result, const bool with_tags,
+void input::NodesProvider::parse_node_query_result(PGresult* result, const bool with_tags,
         const osmium::object_id_type id) {
     int id_field_offset = m_metadata.count();
     int tags_field_offset = m_metadata.count();
@@ -77,37 +130,36 @@ bool input::NodesProvider::get_node_with_tags(const osmium::object_id_type id, c
         ++tags_field_offset;
     }
     int other_field_offset = with_tags ? tags_field_offset + 1 : tags_field_offset;
-    int additional_values_offset = other_field_offset + 2;
+    // Untagged nodes are either stored as two integer columns (x and y) or as a geometry.
+    const bool fixed_point_columns = !with_tags && !m_config.m_untagged_nodes_geom;
+    int additional_values_offset = fixed_point_columns ? other_field_offset + 2 : other_field_offset + 1;
     int tuple_count = PQntuples(result);
     postgres_drivers::ColumnsVector& point_columns = m_column_config_parser.point_columns();
     std::vector<const char*> additional_values {point_columns.size(), nullptr};
+    BinaryMetadataValues metadata;
     for (int i = 0; i < tuple_count; ++i) { // for each returned row
-        double x, y;
-        if (!with_tags && !m_config.m_untagged_nodes_geom) {
-            x = osmium::Location::fix_to_double(atoi(PQgetvalue(result, i, other_field_offset)));
-            y = osmium::Location::fix_to_double(atoi(PQgetvalue(result, i, other_field_offset + 1)));
+        osmium::Location location;
+        if (fixed_point_columns) {
+            location = osmium::Location{binary_result::get_int4(result, i, other_field_offset),
+                binary_result::get_int4(result, i, other_field_offset + 1)};
         } else {
-            x = atof(PQgetvalue(result, i, other_field_offset));
-            y = atof(PQgetvalue(result, i, other_field_offset + 1));
+            location = binary_result::get_wkb_point(result, i, other_field_offset);
         }
-        osmium::Location location{x, y};
         osmium::object_id_type osm_id = id;
         if (id == 0) {
-            osm_id = strtoll(PQgetvalue(result, i, id_field_offset), nullptr, 10);
+            osm_id = binary_result::get_int8(result, i, id_field_offset);
         }
-        const char* version = m_metadata.has_version() ? PQgetvalue(result, i, m_metadata.version()) : nullptr;
-        const char* uid = m_metadata.has_uid() ? PQgetvalue(result, i, m_metadata.uid()) : nullptr;
-        const char* timestamp = m_metadata.has_last_modified() ? PQgetvalue(result, i, m_metadata.last_modified()) : nullptr;
-        const char* changeset = m_metadata.has_changeset() ? PQgetvalue(result, i, m_metadata.changeset()) : nullptr;
+        metadata.read(m_metadata, result, i);
         for (size_t j = 0; j < point_columns.size(); ++j) {
-            additional_values[j] = PQgetvalue(result, i, additional_values_offset + j);
+            additional_values[j] = binary_result::get_text(result, i, additional_values_offset + j);
         }
         if (with_tags) {
-            std::string tags_hstore = PQgetvalue(result, i, tags_field_offset);
-            m_add_node_callback(osm_id, location, version, changeset, uid, timestamp,
-                    std::move(tags_hstore), point_columns, additional_values);
+            std::string tags_hstore = binary_result::get_text(result, i, tags_field_offset);
+            m_add_node_callback(osm_id, location, metadata.version, metadata.changeset, metadata.uid,
+                    metadata.timestamp, std::move(tags_hstore), point_columns, additional_values);
         } else {
-            m_add_node_without_tags_callback(osm_id, location, version, changeset, uid, timestamp);
+            m_add_node_without_tags_callback(osm_id, location, metadata.version, metadata.changeset,
+                    metadata.uid, metadata.timestamp);
         }
     }
 }
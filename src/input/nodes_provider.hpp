@@ -39,14 +39,30 @@ namespace input {
         osm_vector_tile_impl::simple_node_callback_type m_add_simple_node_callback;
 
         /**
-         * Get the location of a node from the storage of untagged nodes.
+         * \brief Get nodes by their IDs and call the callbacks for all nodes found.
          *
-         * \param id node ID
-         * \param param_values array whose first and only member is a C-string with the ID of the node
+         * The IDs are queried in batches of up to OSMDataTable::ID_ARRAY_BATCH_SIZE IDs.
          *
-         * \returns true if found
+         * \param table table to query
+         * \param prepared_statement_name name of the prepared statement to use; it has to take a
+         *        `bigint[]` as its only parameter and return the ID of the nodes
+         * \param with_tags true if the statement queries the table of tagged nodes
+         * \param ids IDs of the nodes, sorted in ascending order
+         *
+         * \returns IDs which were not found, sorted in ascending order
+         */
+        std::vector<osmium::object_id_type> get_nodes_by_ids(OSMDataTable& table,
+                const char* prepared_statement_name, const bool with_tags,
+                const std::vector<osmium::object_id_type>& ids);
+
+        /**
+         * \brief Get nodes from the table of tagged nodes.
+         *
+         * \param ids IDs of the nodes, sorted in ascending order
+         *
+         * \returns IDs which were not found, sorted in ascending order
          */
-        bool get_node_with_tags(const osmium::object_id_type id, char** param_values);
+        std::vector<osmium::object_id_type> get_nodes_with_tags(const std::vector<osmium::object_id_type>& ids);
 
         void create_prepared_statements();
 
@@ -65,14 +81,61 @@ namespace input {
 
         void set_add_simple_node_callback(osm_vector_tile_impl::simple_node_callback_type& callback);
 
-        void set_bbox(const BoundingBox& bbox);
+        virtual void set_bbox(const BoundingBox& bbox);
+
+        /**
+         * \brief Set the metatile whose data is queried by spatial queries, see OSMDataTable::set_metatile().
+         */
+        virtual void set_metatile(const Metatile& metatile);
+
+        /**
+         * \brief Set a callback receiving the latency of spatial queries, see OSMDataTable::set_latency_callback().
+         */
+        virtual void set_latency_callback(OSMDataTable::latency_callback_type callback);
+
+        /**
+         * \brief Summarize the nodes of a tile for change detection, see OSMDataTable::source_state().
+         *
+         * \throws std::runtime_error
+         */
+        virtual std::string source_state(const BoundingBox& bbox);
+
+        /**
+         * \brief Estimate the number of nodes queried by get_nodes_inside() for a tile, see
+         * OSMDataTable::estimate_rows().
+         *
+         * \throws std::runtime_error
+         */
+        virtual double estimate_rows(const BoundingBox& bbox);
 
         /**
          * \brief Get all nodes in the tile
          *
          * \throws std::runtime_error
          */
-        void get_nodes_inside();
+        virtual void get_nodes_inside();
+
+        /**
+         * \brief Send the spatial queries for the nodes in the tile without waiting for their results.
+         *
+         * Call receive_nodes_inside() afterwards. All tables queried by this method must use
+         * different database connections.
+         *
+         * \throws std::runtime_error
+         */
+        virtual void send_nodes_inside();
+
+        /**
+         * \brief Receive the results of the queries sent by send_nodes_inside().
+         *
+         * \throws std::runtime_error
+         */
+        virtual void receive_nodes_inside();
+
+        /**
+         * \brief Cancel the queries sent by send_nodes_inside() if their results will not be received.
+         */
+        virtual void cancel_nodes_inside();
 
         /**
          * \brief Get all missing nodes
@@ -84,6 +147,9 @@ namespace input {
         /**
          * \brief Parse the response of the database after querying nodes
          *
+         * The query result has to be in binary format. Coordinates are either a point geometry
+         * or two integer columns (x and y) for untagged nodes if m_untagged_nodes_geom is not set.
+         *
          * Does not clean up memory afterwards!
          *
          * \param result query result
@@ -7,6 +7,9 @@
 
 #include "osm2pgsql_data_access.hpp"
 #include "nodes_provider_factory.hpp"
+#include "relation_closure.hpp"
+#include <assert.h>
+#include <stdexcept>
 #include <array_parser.hpp>
 #include <osmium/osm/types_from_string.hpp>
 
@@ -18,7 +21,7 @@ postgres_drivers::Column input::Osm2pgsqlDataAccess::nodes {"nodes", postgres_dr
 postgres_drivers::Column input::Osm2pgsqlDataAccess::members {"members", postgres_drivers::ColumnType::TEXT_ARRAY, postgres_drivers::ColumnClass::RELATION_TYPE_ID_ROLE};
 
 OSMDataTable input::Osm2pgsqlDataAccess::build_table(const char* name,
-        VectortileGeneratorConfig& config, postgres_drivers::ColumnsVector&& core_columns,
+        VectortileGeneratorConfig& config, PGconn* connection, postgres_drivers::ColumnsVector&& core_columns,
         postgres_drivers::ColumnsVector* additional_columns) {
     postgres_drivers::Columns cols {std::move(core_columns), postgres_drivers::TableType::OTHER};
     if (additional_columns) {
@@ -26,28 +29,44 @@ OSMDataTable input::Osm2pgsqlDataAccess::build_table(const char* name,
             cols.push_back(c);
         }
     }
-    return OSMDataTable{name, config.m_postgres_config, std::move(cols)};
+    OSMDataTable table {name, config.m_postgres_config, std::move(cols), connection};
+    table.set_chunk_size(config.m_chunk_size);
+    if (config.metatiles_enabled()) {
+        table.enable_metatiles();
+    }
+    return table;
 }
 
 input::Osm2pgsqlDataAccess::Osm2pgsqlDataAccess(VectortileGeneratorConfig& config,
         input::ColumnConfigParser& column_config_parser) :
+    m_config(config),
+    m_connection_manager(new ConnectionManager(config.m_postgres_config.m_database_name)),
     m_nodes_provider(),
-    m_line_table(build_table("planet_osm_line", config, {osm_id, tags, way_column}, &(column_config_parser.line_columns()))),
-    m_ways_table(build_table("planet_osm_ways", config, {osm_id, nodes})),
-    m_polygon_table(build_table("planet_osm_polygon", config, {osm_id, tags, way_column}, &(column_config_parser.polygon_columns()))),
-    m_rels_table(build_table("planet_osm_rels", config, {osm_id, members})) {
+    m_line_table(build_table("planet_osm_line", config, connection(LINES_SLOT), {osm_id, tags, way_column}, &(column_config_parser.line_columns()))),
+    m_ways_table(build_table("planet_osm_ways", config, connection(NODES_SLOT), {osm_id, nodes})),
+    m_polygon_table(build_table("planet_osm_polygon", config, connection(POLYGONS_SLOT), {osm_id, tags, way_column}, &(column_config_parser.polygon_columns()))),
+    m_relation_polygon_table(build_table("planet_osm_polygon", config, connection(RELATION_POLYGONS_SLOT), {osm_id, tags, way_column}, &(column_config_parser.polygon_columns()))),
+    m_rels_table(build_table("planet_osm_rels", config, connection(NODES_SLOT), {osm_id, members})) {
     postgres_drivers::Columns point_columns {{osm_id, tags, point_column}, postgres_drivers::TableType::OTHER};
     point_columns.insert(column_config_parser.point_columns());
-    OSMDataTable point_table {"planet_osm_point", config.m_postgres_config, std::move(point_columns)};
+    OSMDataTable point_table {"planet_osm_point", config.m_postgres_config, std::move(point_columns),
+        connection(NODES_SLOT)};
+    point_table.set_chunk_size(config.m_chunk_size);
+    if (config.metatiles_enabled()) {
+        point_table.enable_metatiles();
+    }
     m_nodes_provider = input::NodesProviderFactory::flatnodes_provider(config, column_config_parser, std::move(point_table));
     create_prepared_statements();
 }
 
 input::Osm2pgsqlDataAccess::Osm2pgsqlDataAccess(Osm2pgsqlDataAccess&& other) :
+    m_config(other.m_config),
+    m_connection_manager(std::move(other.m_connection_manager)),
     m_nodes_provider(std::move(other.m_nodes_provider)),
     m_line_table(std::move(other.m_line_table)),
     m_ways_table(std::move(other.m_ways_table)),
     m_polygon_table(std::move(other.m_polygon_table)),
+    m_relation_polygon_table(std::move(other.m_relation_polygon_table)),
     m_rels_table(std::move(other.m_rels_table)),
     m_add_way_callback(other.m_add_way_callback),
     m_add_relation_callback(other.m_add_relation_callback) {
@@ -55,23 +74,76 @@ input::Osm2pgsqlDataAccess::Osm2pgsqlDataAccess(Osm2pgsqlDataAccess&& other) :
 
 void input::Osm2pgsqlDataAccess::create_prepared_statements() {
     // ways
-    std::string query = "SELECT osm_id FROM %1% WHERE ST_INTERSECTS(way, ST_MakeEnvelope($1, $2, $3, $4, 4326)) AND osm_id > 0";
-    query = (boost::format(query) % m_line_table.get_name()).str();
-    m_line_table.create_prepared_statement("get_lines", query, 4);
+    const std::string intersects = "ST_INTERSECTS(way, %1%)";
+    std::string query = "SELECT osm_id %1% FROM %2% WHERE %3% AND osm_id > 0";
+    query = (boost::format(query) % m_line_table.tile_mask_column(intersects) % m_line_table.get_name()
+            % OSMDataTable::bbox_condition(intersects)).str();
+    m_line_table.create_prepared_statement("get_lines", query, m_line_table.bbox_parameter_count());
+
+    query = "SELECT osm_id %1% FROM %2% WHERE %3% AND osm_id > 0";
+    query = (boost::format(query) % m_polygon_table.tile_mask_column(intersects) % m_polygon_table.get_name()
+            % OSMDataTable::bbox_condition(intersects)).str();
+    m_polygon_table.create_prepared_statement("get_way_polygons", query, m_polygon_table.bbox_parameter_count());
 
-    query = "SELECT osm_id FROM %1% WHERE ST_INTERSECTS(way, ST_MakeEnvelope($1, $2, $3, $4, 4326)) AND osm_id > 0";
-    query = (boost::format(query) % m_polygon_table.get_name()).str();
-    m_polygon_table.create_prepared_statement("get_way_polygons", query, 4);
+    query = "SELECT -osm_id AS osm_id %1% FROM %2% WHERE %3% AND osm_id < 0";
+    query = (boost::format(query) % m_relation_polygon_table.tile_mask_column(intersects) % m_polygon_table.get_name()
+            % OSMDataTable::bbox_condition(intersects)).str();
+    m_relation_polygon_table.create_prepared_statement("get_relation_polygons", query,
+            m_relation_polygon_table.bbox_parameter_count());
 
-    query = "SELECT -osm_id AS osm_id FROM %1% WHERE ST_INTERSECTS(way, ST_MakeEnvelope($1, $2, $3, $4, 4326)) AND osm_id < 0";
-    query = (boost::format(query) % m_polygon_table.get_name()).str();
-    m_polygon_table.create_prepared_statement("get_relation_polygons", query, 4);
+    query = "SELECT id, nodes, tags FROM %1% WHERE id = ANY($1::bigint[])";
+    query = (boost::format(query) % m_ways_table.get_name()).str();
+    m_ways_table.create_prepared_statement("get_ways_by_ids", query, 1);
+
+    query = "SELECT id, members, tags FROM %1% WHERE id = ANY($1::bigint[])";
+    query = (boost::format(query) % m_rels_table.get_name()).str();
+    m_rels_table.create_prepared_statement("get_relations_by_ids", query, 1);
+
+    // relations which are members of relations, see get_missing_relations()
+    // Members are stored as pairs of type+ID and role.
+    query = "SELECT DISTINCT substring(u.member FROM 2)::bigint FROM %1% AS r" \
+            " CROSS JOIN LATERAL unnest(r.members) WITH ORDINALITY AS u(member, position)" \
+            " WHERE r.id = ANY($1::bigint[]) AND u.position %% 2 = 1 AND u.member LIKE 'r%%'";
+    query = (boost::format(query) % m_rels_table.get_name()).str();
+    m_rels_table.create_prepared_statement("get_member_relations", query, 1);
+}
+
+PGconn* input::Osm2pgsqlDataAccess::connection(const size_t slot) {
+    if (m_config.m_async_queries) {
+        return m_connection_manager->get(slot);
+    }
+    return m_connection_manager->get(NODES_SLOT);
 }
 
 void input::Osm2pgsqlDataAccess::set_bbox(const BoundingBox& bbox) {
     m_nodes_provider->set_bbox(bbox);
     m_line_table.set_bbox(bbox);
     m_polygon_table.set_bbox(bbox);
+    m_relation_polygon_table.set_bbox(bbox);
+}
+
+void input::Osm2pgsqlDataAccess::set_metatile(const Metatile& metatile) {
+    m_nodes_provider->set_metatile(metatile);
+    m_line_table.set_metatile(metatile);
+    m_polygon_table.set_metatile(metatile);
+    m_relation_polygon_table.set_metatile(metatile);
+}
+
+void input::Osm2pgsqlDataAccess::set_latency_callback(OSMDataTable::latency_callback_type callback) {
+    m_nodes_provider->set_latency_callback(callback);
+    m_line_table.set_latency_callback(callback);
+    m_polygon_table.set_latency_callback(callback);
+    m_relation_polygon_table.set_latency_callback(callback);
+}
+
+std::string input::Osm2pgsqlDataAccess::source_state(const BoundingBox&) {
+    throw std::runtime_error{"The osm2pgsql input does not support change detection."};
+}
+
+double input::Osm2pgsqlDataAccess::estimate_rows(const BoundingBox& bbox) {
+    return m_nodes_provider->estimate_rows(bbox) + m_line_table.estimate_rows("get_lines", bbox)
+            + m_polygon_table.estimate_rows("get_way_polygons", bbox)
+            + m_relation_polygon_table.estimate_rows("get_relation_polygons", bbox);
 }
 
 void input::Osm2pgsqlDataAccess::set_add_node_callback(osm_vector_tile_impl::node_callback_type&& callback,
@@ -100,19 +172,24 @@ void input::Osm2pgsqlDataAccess::get_missing_nodes(const osm_vector_tile_impl::o
     m_nodes_provider->get_missing_nodes(missing_nodes);
 }
 
-std::vector<osmium::object_id_type> input::Osm2pgsqlDataAccess::get_ids_inside(
-        OSMDataTable& table, const char* prepared_statement_name) {
+std::vector<osmium::object_id_type> input::Osm2pgsqlDataAccess::receive_ids(OSMDataTable& table) {
     std::vector<osmium::object_id_type> ids;
-    PGresult* result = table.run_prepared_bbox_statement(prepared_statement_name);
-    int tuple_count = PQntuples(result);
-    ids.reserve(tuple_count);
-    for (int i = 0; i < tuple_count; i++) { // for each returned row
-        ids.push_back(strtoll(PQgetvalue(result, i, 0), nullptr, 10));
-    }
-    PQclear(result);
+    table.receive_results([&](PGresult* result) {
+        int tuple_count = PQntuples(result);
+        ids.reserve(ids.size() + tuple_count);
+        for (int i = 0; i < tuple_count; i++) { // for each returned row
+            ids.push_back(strtoll(PQgetvalue(result, i, 0), nullptr, 10));
+        }
+    });
     return ids;
 }
 
+std::vector<osmium::object_id_type> input::Osm2pgsqlDataAccess::get_ids_inside(
+        OSMDataTable& table, const char* prepared_statement_name) {
+    table.send_prepared_bbox_statement(prepared_statement_name);
+    return receive_ids(table);
+}
+
 void input::Osm2pgsqlDataAccess::throw_db_related_exception(const char* templ,
         const char* table_name, const osmium::object_id_type id) {
     constexpr unsigned long int len_msg = 255;
@@ -121,18 +198,13 @@ void input::Osm2pgsqlDataAccess::throw_db_related_exception(const char* templ,
     throw std::runtime_error{msg.get()};
 }
 
-void input::Osm2pgsqlDataAccess::query_and_flush_ways(char* sql_query) {
-    PGresult* result = m_ways_table.send_select_query(sql_query);
+void input::Osm2pgsqlDataAccess::parse_way_query_result(PGresult* result) {
     int row_count = PQntuples(result);
-    if (row_count == 0) {
-        return;
-    }
     for (int i = 0; i < row_count; ++i) {
         osmium::object_id_type id = strtoll(PQgetvalue(result, i, 0), nullptr, 10);
         std::vector<postgres_drivers::MemberIdPos> node_ids;
         std::string nodes_arr_str = PQgetvalue(result, i, 1);
         if (nodes_arr_str.empty()) {
-            PQclear(result);
             throw_db_related_exception("Database is in inconsistent state. There are no nodes in %s table for way %ld.",
                             m_ways_table.get_name().c_str(), id);
         }
@@ -148,17 +220,16 @@ void input::Osm2pgsqlDataAccess::query_and_flush_ways(char* sql_query) {
         m_add_way_callback(id, std::move(node_ids), nullptr, nullptr, nullptr, nullptr,
                 tags);
     }
-    PQclear(result);
+}
+
+void input::Osm2pgsqlDataAccess::get_ways_by_ids(const std::vector<osmium::object_id_type>& ids) {
+    m_ways_table.run_prepared_id_array_statement("get_ways_by_ids", ids, [&](PGresult* result) {
+        parse_way_query_result(result);
+    });
 }
 
 void input::Osm2pgsqlDataAccess::get_ways(OSMDataTable& table, const char* prepared_statement_name) {
-    std::vector<osmium::object_id_type> ids = get_ids_inside(table, prepared_statement_name);
-    get_objects_from_db<std::vector<osmium::object_id_type>::iterator>(ids.begin(), ids.end(),
-        "id, nodes, tags", m_ways_table.get_name().c_str(),
-        [this](char* sql_query) {
-            this->query_and_flush_ways(sql_query);
-        }
-    );
+    get_ways_by_ids(get_ids_inside(table, prepared_statement_name));
 }
 
 void input::Osm2pgsqlDataAccess::get_ways_inside() {
@@ -167,13 +238,7 @@ void input::Osm2pgsqlDataAccess::get_ways_inside() {
 }
 
 void input::Osm2pgsqlDataAccess::get_missing_ways(const osm_vector_tile_impl::osm_id_set_type& missing_ways) {
-    using iterator_type = osm_vector_tile_impl::osm_id_set_type::const_iterator;
-    get_objects_from_db<iterator_type>(missing_ways.begin(), missing_ways.end(),
-        "id, nodes, tags", m_ways_table.get_name().c_str(),
-        [this](char* sql_query) {
-            this->query_and_flush_ways(sql_query);
-        }
-    );
+    get_ways_by_ids({missing_ways.begin(), missing_ways.end()});
 }
 
 std::vector<osm_vector_tile_impl::StringPair> input::Osm2pgsqlDataAccess::tags_from_pg_string_array(std::string& tags_arr_str) {
@@ -195,13 +260,8 @@ std::vector<osm_vector_tile_impl::StringPair> input::Osm2pgsqlDataAccess::tags_f
     return tags;
 }
 
-void input::Osm2pgsqlDataAccess::query_and_flush_relations(char* sql_query) {
-    PGresult* result = m_rels_table.send_select_query(sql_query);
+void input::Osm2pgsqlDataAccess::parse_relation_query_result(PGresult* result) {
     int row_count = PQntuples(result);
-    if (row_count == 0) {
-        PQclear(result);
-        return;
-    }
     for (int i = 0; i < row_count; ++i) {
         osmium::object_id_type id = strtoll(PQgetvalue(result, i, 0), nullptr, 10);
         std::vector<osm_vector_tile_impl::MemberIdRoleTypePos> members;
@@ -228,25 +288,61 @@ void input::Osm2pgsqlDataAccess::query_and_flush_relations(char* sql_query) {
         std::vector<osm_vector_tile_impl::StringPair> tags = tags_from_pg_string_array(tags_arr_str);
         m_add_relation_callback(id, std::move(members), nullptr, nullptr, nullptr, nullptr, tags);
     }
-    PQclear(result);
+}
+
+void input::Osm2pgsqlDataAccess::get_relations_by_ids(const std::vector<osmium::object_id_type>& ids) {
+    m_rels_table.run_prepared_id_array_statement("get_relations_by_ids", ids, [&](PGresult* result) {
+        parse_relation_query_result(result);
+    });
 }
 
 void input::Osm2pgsqlDataAccess::get_relations_inside() {
-    std::vector<osmium::object_id_type> ids = get_ids_inside(m_polygon_table, "get_relation_polygons");
-    get_objects_from_db<std::vector<osmium::object_id_type>::iterator>(ids.begin(), ids.end(),
-        "id, members, tags", m_rels_table.get_name().c_str(),
-        [this](char* sql_query) {
-            this->query_and_flush_relations(sql_query);
-        }
-    );
+    get_relations_by_ids(get_ids_inside(m_relation_polygon_table, "get_relation_polygons"));
+}
+
+void input::Osm2pgsqlDataAccess::get_objects_inside() {
+    assert(m_config.m_async_queries);
+    m_nodes_provider->send_nodes_inside();
+    m_line_table.send_prepared_bbox_statement("get_lines");
+    m_polygon_table.send_prepared_bbox_statement("get_way_polygons");
+    m_relation_polygon_table.send_prepared_bbox_statement("get_relation_polygons");
+    // The IDs of ways and relations are received before the nodes are processed because
+    // their queries are usually faster.
+    std::vector<osmium::object_id_type> line_ids;
+    std::vector<osmium::object_id_type> polygon_ids;
+    std::vector<osmium::object_id_type> relation_ids;
+    try {
+        line_ids = receive_ids(m_line_table);
+        polygon_ids = receive_ids(m_polygon_table);
+        relation_ids = receive_ids(m_relation_polygon_table);
+    } catch (...) {
+        m_line_table.cancel_and_discard_results();
+        m_polygon_table.cancel_and_discard_results();
+        m_relation_polygon_table.cancel_and_discard_results();
+        m_nodes_provider->cancel_nodes_inside();
+        throw;
+    }
+    // Nodes have to be processed before ways and ways before relations because the callbacks
+    // check which referenced objects are missing.
+    m_nodes_provider->receive_nodes_inside();
+    get_ways_by_ids(line_ids);
+    get_ways_by_ids(polygon_ids);
+    get_relations_by_ids(relation_ids);
 }
 
 void input::Osm2pgsqlDataAccess::get_missing_relations(const osm_vector_tile_impl::osm_id_set_type& missing_relations) {
-    using iterator_type = osm_vector_tile_impl::osm_id_set_type::const_iterator;
-    get_objects_from_db<iterator_type>(missing_relations.begin(), missing_relations.end(),
-        "id, members, tags", m_rels_table.get_name().c_str(),
-        [this](char* sql_query) {
-            this->query_and_flush_relations(sql_query);
-        }
-    );
+    if (missing_relations.empty()) {
+        return;
+    }
+    std::vector<osmium::object_id_type> ids = relation_closure({missing_relations.begin(), missing_relations.end()},
+            m_config.m_max_relation_depth, [&](const std::vector<osmium::object_id_type>& relations,
+            std::vector<osmium::object_id_type>& members) {
+        m_rels_table.run_prepared_id_array_statement("get_member_relations", relations, [&](PGresult* result) {
+            int tuple_count = PQntuples(result);
+            for (int i = 0; i < tuple_count; ++i) {
+                members.push_back(strtoll(PQgetvalue(result, i, 0), nullptr, 10));
+            }
+        });
+    });
+    get_relations_by_ids(ids);
 }
@@ -8,6 +8,7 @@
 #ifndef SRC_INPUT_OSM2PGSQL_DATA_ACCESS_HPP_
 #define SRC_INPUT_OSM2PGSQL_DATA_ACCESS_HPP_
 
+#include "../connection_manager.hpp"
 #include "../osm_data_table.hpp"
 #include "column_config_parser.hpp"
 #include "nodes_provider.hpp"
@@ -23,6 +24,25 @@ namespace input {
         static postgres_drivers::Column nodes;
         static postgres_drivers::Column members;
 
+        /// connection slot of the tables of nodes, ways and relations
+        static constexpr size_t NODES_SLOT = 0;
+        /// connection slot of the spatial queries on `planet_osm_line` table
+        static constexpr size_t LINES_SLOT = 1;
+        /// connection slot of the spatial queries for ways on `planet_osm_polygon` table
+        static constexpr size_t POLYGONS_SLOT = 2;
+        /// connection slot of the spatial queries for relations on `planet_osm_polygon` table
+        static constexpr size_t RELATION_POLYGONS_SLOT = 3;
+
+        VectortileGeneratorConfig& m_config;
+
+        /**
+         * \brief database connections shared by the tables
+         *
+         * One connection is sufficient unless queries are sent asynchronously because no queries
+         * are sent while results are streamed.
+         */
+        std::unique_ptr<ConnectionManager> m_connection_manager;
+
         /// reference to `untagged_nodes` table
         std::unique_ptr<input::NodesProvider> m_nodes_provider;
         /// reference to `planet_osm_line` table
@@ -31,6 +51,8 @@ namespace input {
         OSMDataTable m_ways_table;
         /// reference to `planet_osm_polygon` table
         OSMDataTable m_polygon_table;
+        /// reference to `planet_osm_polygon` table to query relations (uses its own connection in asynchronous mode)
+        OSMDataTable m_relation_polygon_table;
         /// reference to `planet_osm_rels` table
         OSMDataTable m_rels_table;
 
@@ -75,78 +97,59 @@ namespace input {
         std::vector<osmium::object_id_type> get_ids_inside(OSMDataTable& table, const char* prepared_statement_name);
 
         /**
-         * \brief Get nodes and tags of a way from the planet_osm_ways table and call the callback
-         * to create the OSM ways in the output file.
+         * \brief Receive the result of a spatial query for object IDs sent before.
+         *
+         * \param table database table the query was sent to
+         *
+         * \returns vector of object IDs
+         */
+        std::vector<osmium::object_id_type> receive_ids(OSMDataTable& table);
+
+        /**
+         * \brief Get the connection of a slot.
          *
-         * \param id_list list of OSM IDs to query separated by comma to be inserted into the SQL statement
+         * Each slot has its own connection if queries are sent asynchronously. Otherwise, all tables
+         * share one connection.
+         *
+         * \param slot one of the *_SLOT constants
          */
-        void query_and_flush_ways(char* id_list);
+        PGconn* connection(const size_t slot);
 
         /**
-         * \brief Parse the response of the database after querying relations
+         * \brief Get ways by their IDs from planet_osm_ways table and call the callback for each way.
+         *
+         * \param ids way IDs
+         */
+        void get_ways_by_ids(const std::vector<osmium::object_id_type>& ids);
+
+        /**
+         * \brief Get relations by their IDs from planet_osm_rels table and call the callback for each relation.
+         *
+         * \param ids relation IDs
+         */
+        void get_relations_by_ids(const std::vector<osmium::object_id_type>& ids);
+
+        /**
+         * \brief Parse the response of the database after querying ways from the planet_osm_ways
+         * table and call the callback to create the OSM ways in the output file.
          *
          * Does not clean up memory afterwards!
          *
          * \param result query result
+         *
+         * \throws std::runtime_error if a way has no nodes
          */
-        void parse_relation_query_result(PGresult* result);
+        void parse_way_query_result(PGresult* result);
 
         /**
-         * \brief Iterate over a container of OSM object IDs and call a callback function for each batch of IDs.
-         *
-         * This method joins the IDs to a comma separated list of IDs as template argument for a
-         * prepared SQL statement and calls the callback function with this list. Each list consists of a batch
-         * of up to 100 IDs.
-         *
-         * \param begin iterator pointing to the first element in the input container
-         * \param end iterator pointing to the first element after the range
-         * \param fields fields to query (comma separated list of field names, will be inserted
-         *        into the SQL query directly without escaping)
-         * \param callback callback to be called
-         *
-         * \tparam TIterator iterator of a container of osmium::object_id_type
-         */
-        template <typename TIterator>
-        void get_objects_from_db(TIterator begin, TIterator end, const char* fields,
-                const char* table_name, std::function<void(char*)> callback) {
-            constexpr unsigned long int batch_size = 100;
-            constexpr unsigned long int number_width = 25;
-            constexpr unsigned long int str_maxlen = number_width * batch_size + 1;
-            char sql[str_maxlen];
-            const char* sql_template = "SELECT %s FROM %s WHERE id IN (";
-            int printed = snprintf(sql, str_maxlen - 26, sql_template, fields, table_name);
-            char* sql_ptr = sql + printed;
-            size_t rel_count = 0;
-            for (auto it = begin; it != end; ++it) {
-                int printed_chars = 0;
-                if (rel_count > 0) {
-                    printed_chars = sprintf(sql_ptr, ",%ld", *it);
-                } else {
-                    printed_chars = sprintf(sql_ptr, "%ld", *it);
-                }
-                sql_ptr = sql_ptr + printed_chars;
-                ++rel_count;
-                if (rel_count == batch_size || str_maxlen - (sql_ptr - sql) - 3 < number_width) {
-                    sprintf(sql_ptr, ");");
-                    callback(sql);
-                    rel_count = 0;
-                    printed_chars = snprintf(sql, str_maxlen - 26, sql_template, fields, table_name);
-                    sql_ptr = sql + printed_chars;
-                }
-            }
-            if (rel_count > 0) {
-                sprintf(sql_ptr, ");");
-                callback(sql);
-            }
-        }
-
-        /**
-         * \brief Get relation members and tags from the planet_osm_rels table and call the
-         * callback to create the OSM relations in the output file.
-         *
-         * \param id_list list of OSM relation IDs
-         */
-        void query_and_flush_relations(char* id_list);
+         * \brief Parse the response of the database after querying relations from the planet_osm_rels
+         * table and call the callback to create the OSM relations in the output file.
+         *
+         * Does not clean up memory afterwards!
+         *
+         * \param result query result
+         */
+        void parse_relation_query_result(PGresult* result);
 
         /**
          * Retrieve ways from planet_osm_line or planet_osm_polygon table (tags) and
@@ -162,11 +165,12 @@ namespace input {
          *
          * \param name name of the table
          * \param config programme config
+         * \param connection database connection to use
          * \param core_columns columns which are always present such as osm_id and tags
          * \param additional_columns additional columns depending on database style
          */
         static OSMDataTable build_table(const char* name, VectortileGeneratorConfig& config,
-                postgres_drivers::ColumnsVector&& core_columns,
+                PGconn* connection, postgres_drivers::ColumnsVector&& core_columns,
                 postgres_drivers::ColumnsVector* additional_columns = nullptr);
 
     public:
@@ -177,6 +181,41 @@ namespace input {
 
         void set_bbox(const BoundingBox& bbox);
 
+        /**
+         * \brief Set the metatile whose data is queried by spatial queries.
+         *
+         * Select the tile to build using set_bbox() afterwards. Metatiles have to be enabled
+         * in the configuration.
+         */
+        void set_metatile(const Metatile& metatile);
+
+        /**
+         * \brief Set a callback receiving the latency of spatial queries, see OSMDataTable::set_latency_callback().
+         */
+        void set_latency_callback(OSMDataTable::latency_callback_type callback);
+
+        /**
+         * \brief Change detection is not supported by this input.
+         *
+         * The tables of Osm2pgsql neither have modification timestamps (unless imported with
+         * --extra-attributes) nor contain the untagged nodes with a geometry. Moved nodes could not be
+         * detected.
+         *
+         * \throws std::runtime_error always
+         */
+        std::string source_state(const BoundingBox& bbox);
+
+        /**
+         * \brief Estimate the number of rows returned by the spatial queries of a tile.
+         *
+         * The estimates of the query planner are used, the queries are not executed.
+         *
+         * \param bbox bounding box of the tile
+         *
+         * \throws std::runtime_error
+         */
+        double estimate_rows(const BoundingBox& bbox);
+
         void set_add_node_callback(osm_vector_tile_impl::node_callback_type&& callback,
                 osm_vector_tile_impl::node_without_tags_callback_type&& callback_without_tags,
                 osm_vector_tile_impl::simple_node_callback_type&& simple_callback);
@@ -221,7 +260,22 @@ namespace input {
         void get_relations_inside();
 
         /**
-         * \brief Get all missing relations
+         * \brief Get all nodes, ways and relations inside the tile.
+         *
+         * The spatial queries are sent at once on separate connections and their results are
+         * processed afterwards in the order nodes, ways, relations. This requires asynchronous
+         * queries to be enabled in the configuration.
+         *
+         * \throws std::runtime_error
+         */
+        void get_objects_inside();
+
+        /**
+         * \brief Get all missing relations and all relations which are members of them (recursively)
+         *
+         * The members are resolved one nesting level after the other using relation_closure(),
+         * each relation is queried once. The nesting depth is limited by
+         * VectortileGeneratorConfig::m_max_relation_depth.
          *
          * \param missing_relations relations to fetch from the database
          */
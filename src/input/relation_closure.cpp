@@ -0,0 +1,35 @@
+/*
+ * relation_closure.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <unordered_set>
+#include "relation_closure.hpp"
+
+std::vector<osmium::object_id_type> input::relation_closure(const std::vector<osmium::object_id_type>& ids,
+        const int max_depth, member_relations_callback_type member_relations) {
+    std::unordered_set<osmium::object_id_type> visited;
+    std::vector<osmium::object_id_type> closure;
+    for (const osmium::object_id_type id : ids) {
+        if (visited.insert(id).second) {
+            closure.push_back(id);
+        }
+    }
+    // relations of the current nesting level
+    std::vector<osmium::object_id_type> level {closure};
+    std::vector<osmium::object_id_type> members;
+    for (int depth = 0; !level.empty() && (max_depth <= 0 || depth < max_depth); ++depth) {
+        members.clear();
+        member_relations(level, members);
+        level.clear();
+        for (const osmium::object_id_type member : members) {
+            if (visited.insert(member).second) {
+                level.push_back(member);
+                closure.push_back(member);
+            }
+        }
+    }
+    return closure;
+}
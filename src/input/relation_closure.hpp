@@ -0,0 +1,42 @@
+/*
+ * relation_closure.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_INPUT_RELATION_CLOSURE_HPP_
+#define SRC_INPUT_RELATION_CLOSURE_HPP_
+
+#include <functional>
+#include <vector>
+#include <osmium/osm/types.hpp>
+
+namespace input {
+
+    /**
+     * \brief function appending the IDs of the relations which are members of the given relations
+     * to its second argument
+     */
+    using member_relations_callback_type = std::function<void(const std::vector<osmium::object_id_type>&,
+            std::vector<osmium::object_id_type>&)>;
+
+    /**
+     * \brief Find a set of relations and all relations which are members of them (recursively).
+     *
+     * The members are looked up one nesting level after the other. Each relation is visited once,
+     * relations which are members of multiple relations and cycles do not cause additional lookups.
+     * The depth of a relation is the length of the shortest chain of memberships leading to it.
+     *
+     * \param ids relations to start with
+     * \param max_depth maximum nesting depth of the members, 0 means unlimited
+     * \param member_relations function looking up the members of relations
+     *
+     * \returns IDs of the relations and all their members, each of them once
+     */
+    std::vector<osmium::object_id_type> relation_closure(const std::vector<osmium::object_id_type>& ids,
+            const int max_depth, member_relations_callback_type member_relations);
+
+} // namespace input
+
+#endif /* SRC_INPUT_RELATION_CLOSURE_HPP_ */
@@ -4,23 +4,46 @@
  *  Created on:  2016-12-02
  *      Author: Michael Reichert
  */
+#include <algorithm>
+#include <iostream>
 #include <stdexcept>
 #include <boost/format.hpp>
+#include "connection_manager.hpp"
 #include "jobs_database.hpp"
 
-JobsDatabase::JobsDatabase(std::string& database_name) :
-        m_name(database_name) {
-    std::string connection_params = "dbname=";
-    connection_params.append(database_name);
+constexpr size_t JobsDatabase::MAX_BATCH_SIZE;
+
+JobsDatabase::JobsDatabase(std::string& database_name, const int max_delay_ms) :
+        m_name(database_name),
+        m_max_delay(max_delay_ms) {
+    std::string connection_params = ConnectionManager::conninfo(database_name);
     m_database_connection = PQconnectdb(connection_params.c_str());
     if (PQstatus(m_database_connection) != CONNECTION_OK) {
         throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n")
             %  PQerrorMessage(m_database_connection)).str());
     }
     create_prepared_statements();
+    if (m_max_delay.count() > 0) {
+        m_writer = std::thread(&JobsDatabase::write_queued_jobs, this);
+    }
 }
 
 JobsDatabase::~JobsDatabase() {
+    if (m_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_stop = true;
+        }
+        m_queue_changed.notify_all();
+        m_writer.join();
+        if (m_error) {
+            try {
+                std::rethrow_exception(m_error);
+            } catch (std::exception& e) {
+                std::cerr << "ERROR: Writing jobs failed: " << e.what() << '\n';
+            }
+        }
+    }
     PQfinish(m_database_connection);
 }
 
@@ -29,6 +52,181 @@ void JobsDatabase::create_prepared_statements() {
     create_prepared_statement("insert_job", query, 3);
     query = "DELETE FROM jobs WHERE quadtree_id = $1 AND processing = false";
     create_prepared_statement("drop_job", query, 1);
+    query = "INSERT INTO jobs (quadtree_id, created, path)" \
+            " SELECT * FROM unnest($1::bigint[], $2::text[], $3::text[])";
+    create_prepared_statement("insert_jobs", query, 3);
+    query = "DELETE FROM jobs WHERE quadtree_id = ANY($1::bigint[]) AND processing = false";
+    create_prepared_statement("drop_jobs", query, 1);
+}
+
+void JobsDatabase::execute(const char* query) {
+    PGresult *result = PQexec(m_database_connection, query);
+    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+        std::string message = PQresultErrorMessage(result);
+        PQclear(result);
+        throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+    }
+    PQclear(result);
+}
+
+namespace {
+
+    /**
+     * \brief Append an element to a PostgreSQL array literal.
+     *
+     * \param array array literal without the closing brace
+     * \param value value of the element
+     */
+    void append_array_element(std::string& array, const std::string& value) {
+        if (array.size() > 1) {
+            array.push_back(',');
+        }
+        array.push_back('"');
+        for (const char c : value) {
+            if (c == '"' || c == '\\') {
+                array.push_back('\\');
+            }
+            array.push_back(c);
+        }
+        array.push_back('"');
+    }
+
+} // anonymous namespace
+
+void JobsDatabase::enqueue(QueuedJob&& job) {
+    std::unique_lock<std::mutex> lock {m_mutex};
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    if (job.cancel) {
+        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [&](const QueuedJob& queued) {
+            return queued.quadtree_id == job.quadtree_id && !queued.cancel;
+        }), m_queue.end());
+    }
+    // Let the worker wait if the writer cannot keep up.
+    m_batch_written.wait(lock, [this]() {
+        return m_queue.size() < 2 * MAX_BATCH_SIZE || m_error;
+    });
+    if (m_queue.empty()) {
+        m_oldest = std::chrono::steady_clock::now();
+    }
+    m_queue.push_back(std::move(job));
+    if (m_queue.size() == 1 || m_queue.size() >= MAX_BATCH_SIZE) {
+        m_queue_changed.notify_all();
+    }
+}
+
+void JobsDatabase::flush() {
+    if (!m_writer.joinable()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock {m_mutex};
+    m_flush_requested = true;
+    m_queue_changed.notify_all();
+    m_batch_written.wait(lock, [this]() {
+        return (m_queue.empty() && !m_writing) || m_error;
+    });
+    m_flush_requested = false;
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void JobsDatabase::write_queued_jobs() {
+    std::unique_lock<std::mutex> lock {m_mutex};
+    while (true) {
+        m_queue_changed.wait(lock, [this]() {
+            return m_stop || m_flush_requested || !m_queue.empty();
+        });
+        if (m_queue.empty()) {
+            if (m_stop) {
+                return;
+            }
+            m_flush_requested = false;
+            m_batch_written.notify_all();
+            continue;
+        }
+        if (!m_stop && !m_flush_requested && m_queue.size() < MAX_BATCH_SIZE
+                && std::chrono::steady_clock::now() < m_oldest + m_max_delay) {
+            m_queue_changed.wait_until(lock, m_oldest + m_max_delay);
+            continue;
+        }
+        std::vector<QueuedJob> batch;
+        if (m_queue.size() <= MAX_BATCH_SIZE) {
+            batch.swap(m_queue);
+        } else {
+            batch.assign(std::make_move_iterator(m_queue.begin()),
+                    std::make_move_iterator(m_queue.begin() + MAX_BATCH_SIZE));
+            m_queue.erase(m_queue.begin(), m_queue.begin() + MAX_BATCH_SIZE);
+        }
+        // The remaining entries are written without waiting again.
+        m_oldest = std::chrono::steady_clock::now() - m_max_delay;
+        m_writing = true;
+        lock.unlock();
+        try {
+            write_batch(batch);
+        } catch (...) {
+            lock.lock();
+            m_error = std::current_exception();
+            m_writing = false;
+            m_batch_written.notify_all();
+            // Further batches are not written, the error is reported to the worker.
+            m_queue.clear();
+            continue;
+        }
+        lock.lock();
+        m_writing = false;
+        m_batch_written.notify_all();
+    }
+}
+
+void JobsDatabase::write_batch(const std::vector<QueuedJob>& batch) {
+    std::string cancelled = "{";
+    std::string ids = "{";
+    std::string created = "{";
+    std::string paths = "{";
+    for (const QueuedJob& job : batch) {
+        if (job.cancel) {
+            append_array_element(cancelled, std::to_string(job.quadtree_id));
+        } else {
+            append_array_element(ids, std::to_string(job.quadtree_id));
+            append_array_element(created, job.created);
+            append_array_element(paths, job.path);
+        }
+    }
+    for (std::string* array : {&cancelled, &ids, &created, &paths}) {
+        array->push_back('}');
+    }
+    execute("BEGIN");
+    try {
+        if (cancelled.size() > 2) {
+            const char* param_values[1] = {cancelled.c_str()};
+            PGresult *result = PQexecPrepared(m_database_connection, "drop_jobs", 1, param_values, nullptr, nullptr, 0);
+            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+                std::string message = PQresultErrorMessage(result);
+                PQclear(result);
+                throw std::runtime_error((boost::format("Removing jobs from the jobs database failed: %1%\n")
+                        % message).str());
+            }
+            PQclear(result);
+        }
+        if (ids.size() > 2) {
+            const char* param_values[3] = {ids.c_str(), created.c_str(), paths.c_str()};
+            PGresult *result = PQexecPrepared(m_database_connection, "insert_jobs", 3, param_values, nullptr, nullptr, 0);
+            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+                std::string message = PQresultErrorMessage(result);
+                PQclear(result);
+                throw std::runtime_error((boost::format("Inserting jobs into the jobs database failed: %1%\n")
+                        % message).str());
+            }
+            PQclear(result);
+        }
+        execute("COMMIT");
+    } catch (...) {
+        PGresult *result = PQexec(m_database_connection, "ROLLBACK");
+        PQclear(result);
+        throw;
+    }
 }
 
 void JobsDatabase::create_prepared_statement(const char* name, std::string& query, int params_count) {
@@ -43,6 +241,10 @@ void JobsDatabase::create_prepared_statement(const char* name, std::string& quer
 void JobsDatabase::add_job(int x, int y, int zoom, const char* created, const char* vectortile_path) {
     // convert tile ID to quadtree ID
     int64_t quadtree_tile_id = xy_to_quadtree(x, y, zoom);
+    if (m_writer.joinable()) {
+        enqueue(QueuedJob{quadtree_tile_id, false, created, vectortile_path});
+        return;
+    }
     char const *param_values[3];
     char buffer_qt[20];
     sprintf(buffer_qt, "%ld", quadtree_tile_id);
@@ -61,6 +263,10 @@ void JobsDatabase::add_job(int x, int y, int zoom, const char* created, const ch
 
 void JobsDatabase::cancel_job(int x, int y, int zoom) {
     int64_t quadtree_tile_id = xy_to_quadtree(x, y, zoom);
+    if (m_writer.joinable()) {
+        enqueue(QueuedJob{quadtree_tile_id, true, "", ""});
+        return;
+    }
     char const *param_values[1];
     char buffer_qt[20];
     sprintf(buffer_qt, "%ld", quadtree_tile_id);
@@ -79,8 +285,8 @@ void JobsDatabase::cancel_job(int x, int y, int zoom) {
     int64_t qt = 0;
     // the two highest bits are the bits of zoom level 1, the third and fourth bit are level 2, …
     for (int z = 0; z < zoom; z++) {
-        qt = qt + ((x & (1 << z)) << z);
-        qt = qt + ((y & (1 << z)) << (z+1));
+        qt = qt + (static_cast<int64_t>(x & (1 << z)) << z);
+        qt = qt + (static_cast<int64_t>(y & (1 << z)) << (z+1));
     }
     return qt;
 }
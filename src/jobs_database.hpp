@@ -9,7 +9,13 @@
 #define SRC_JOBS_DATABASE_HPP_
 
 #include <libpq-fe.h>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 /**
  * \brief struct for functions returning a x and a y coordinates by one call
@@ -33,8 +39,22 @@ struct xy_coord_t {
  * Before calling the constructor of this class, the database and the table jobs has to be created:
  * ```CREATE TABLE jobs (quadtree_id bigint, processing bool DEFAULT FALSE, created char(21), path text);
  * CREATE INDEX quadtree_id_idx ON jobs USING btree(quadtree_id);```
+ *
+ * Jobs are written immediately by default. If a maximum delay is set, additions and cancellations
+ * are queued and written in batches (one transaction each) by a background thread. A batch is
+ * written if its oldest entry reaches the maximum delay, if it is full or if flush() is called.
+ * The destructor writes all queued entries.
  */
 class JobsDatabase {
+    /// addition or cancellation of a job waiting to be written
+    struct QueuedJob {
+        int64_t quadtree_id;
+        /// true for a cancellation, false for an addition
+        bool cancel;
+        std::string created;
+        std::string path;
+    };
+
     /**
      * \brief connection to database
      */
@@ -45,6 +65,42 @@ class JobsDatabase {
      */
     std::string& m_name;
 
+    /// maximum time an entry is queued, zero if entries are written immediately
+    std::chrono::milliseconds m_max_delay;
+
+    /// protects the following members which are shared with the writer thread
+    std::mutex m_mutex;
+
+    /// signalled if entries are queued, a flush is requested or the writer should stop
+    std::condition_variable m_queue_changed;
+
+    /// signalled if a batch has been written
+    std::condition_variable m_batch_written;
+
+    /// entries waiting to be written
+    std::vector<QueuedJob> m_queue;
+
+    /// time when the oldest entry of m_queue was queued
+    std::chrono::steady_clock::time_point m_oldest;
+
+    /// true while the writer thread writes a batch
+    bool m_writing = false;
+
+    /// true if flush() waits for the queue to be written
+    bool m_flush_requested = false;
+
+    /// true if the writer thread should write all entries and stop
+    bool m_stop = false;
+
+    /// error of the writer thread, rethrown by the next call of a public method
+    std::exception_ptr m_error;
+
+    /// writer thread, not started if entries are written immediately
+    std::thread m_writer;
+
+    /// maximum number of entries written by one transaction
+    static constexpr size_t MAX_BATCH_SIZE = 1000;
+
     /**
      * \brief create some prepared statements for faster writing
      */
@@ -59,19 +115,63 @@ class JobsDatabase {
      */
     void create_prepared_statement(const char* name, std::string& query, int params_count);
 
+    /**
+     * \brief Execute a query without parameters and result.
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void execute(const char* query);
+
+    /**
+     * \brief Queue an addition or cancellation and wait if the queue is full.
+     *
+     * A cancellation removes the queued additions of the same tile, they have not reached the
+     * database yet.
+     *
+     * \throws std::runtime_error if writing a previous batch failed
+     */
+    void enqueue(QueuedJob&& job);
+
+    /**
+     * \brief Main function of the writer thread.
+     */
+    void write_queued_jobs();
+
+    /**
+     * \brief Write a batch of entries using one transaction.
+     *
+     * All cancellations of the batch are executed before the additions. This is equivalent to
+     * the order they were queued in because enqueue() removes additions cancelled later.
+     *
+     * \throws std::runtime_error if a query fails
+     */
+    void write_batch(const std::vector<QueuedJob>& batch);
+
 public:
     /**
      * constructor
      *
-     * \param database_name name of the database
+     * \param database_name name of the database or libpq connection string
+     * \param max_delay_ms maximum time in milliseconds additions and cancellations are queued
+     * before they are written, 0 writes them immediately
      */
-    JobsDatabase(std::string& database_name);
+    JobsDatabase(std::string& database_name, const int max_delay_ms = 0);
+
+    JobsDatabase(const JobsDatabase&) = delete;
+    JobsDatabase& operator=(const JobsDatabase&) = delete;
 
     /**
-     * close connection to database, clean up memory
+     * write queued entries, close connection to database, clean up memory
      */
     ~JobsDatabase();
 
+    /**
+     * \brief Wait until all queued additions and cancellations have been written.
+     *
+     * \throws std::runtime_error if writing them failed
+     */
+    void flush();
+
     /**
      * \brief add a job to the database
      *
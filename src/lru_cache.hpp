@@ -0,0 +1,151 @@
+/*
+ * lru_cache.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_LRU_CACHE_HPP_
+#define SRC_LRU_CACHE_HPP_
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+/**
+ * \brief Cache bounded by the approximate memory usage of its entries.
+ *
+ * The least recently used entries are evicted if the size of all entries exceeds the limit.
+ * The size of an entry is given by the caller when the entry is inserted. The bookkeeping
+ * overhead of the cache (#ENTRY_OVERHEAD per entry) is added.
+ *
+ * \tparam TKey key type
+ * \tparam TValue value type
+ * \tparam THash hash function of the keys
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>>
+class LruCache {
+    struct Entry {
+        TKey key;
+        TValue value;
+        size_t bytes;
+
+        Entry(const TKey& k, TValue&& v, const size_t b) :
+            key(k),
+            value(std::move(v)),
+            bytes(b) {
+        }
+    };
+
+    using list_type = std::list<Entry>;
+
+    /// entries, the most recently used entry is the first one
+    list_type m_entries;
+
+    /// position of the entries in m_entries
+    std::unordered_map<TKey, typename list_type::iterator, THash> m_index;
+
+    /// maximum size of all entries in bytes
+    size_t m_max_bytes;
+
+    /// size of all entries in bytes
+    size_t m_bytes = 0;
+
+    /**
+     * \brief Evict least recently used entries until the size of all entries is below the limit.
+     */
+    void evict() {
+        while (m_bytes > m_max_bytes && !m_entries.empty()) {
+            Entry& last = m_entries.back();
+            m_bytes -= last.bytes;
+            m_index.erase(last.key);
+            m_entries.pop_back();
+        }
+    }
+
+public:
+    /// approximate memory usage of the bookkeeping of an entry (list and hash map nodes)
+    static const size_t ENTRY_OVERHEAD = sizeof(Entry) + sizeof(TKey) + 6 * sizeof(void*);
+
+    /**
+     * \param max_bytes maximum size of all entries in bytes
+     */
+    explicit LruCache(const size_t max_bytes) :
+        m_entries(),
+        m_index(),
+        m_max_bytes(max_bytes) {
+    }
+
+    /**
+     * \brief Look up an entry and mark it as most recently used.
+     *
+     * \returns pointer to the value or nullptr if the key is not cached. The pointer is valid
+     * until the next call of insert().
+     */
+    TValue* find(const TKey& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            return nullptr;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return &(it->second->value);
+    }
+
+    /**
+     * \brief Insert or replace an entry and evict the least recently used entries if necessary.
+     *
+     * Values larger than the maximum size of the cache are not inserted.
+     *
+     * \param key key
+     * \param value value
+     * \param bytes approximate memory usage of the value
+     */
+    void insert(const TKey& key, TValue&& value, size_t bytes) {
+        bytes += ENTRY_OVERHEAD;
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_bytes -= it->second->bytes;
+            m_entries.erase(it->second);
+            m_index.erase(it);
+        }
+        if (bytes > m_max_bytes) {
+            return;
+        }
+        m_entries.emplace_front(key, std::move(value), bytes);
+        m_index.emplace(key, m_entries.begin());
+        m_bytes += bytes;
+        evict();
+    }
+
+    /**
+     * \brief Remove an entry if it is cached.
+     */
+    void erase(const TKey& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            return;
+        }
+        m_bytes -= it->second->bytes;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    /**
+     * \brief number of entries
+     */
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    /**
+     * \brief approximate memory usage of all entries in bytes
+     */
+    size_t bytes() const {
+        return m_bytes;
+    }
+};
+
+template <typename TKey, typename TValue, typename THash>
+const size_t LruCache<TKey, TValue, THash>::ENTRY_OVERHEAD;
+
+#endif /* SRC_LRU_CACHE_HPP_ */
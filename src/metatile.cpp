@@ -0,0 +1,92 @@
+/*
+ * metatile.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include "metatile.hpp"
+
+const size_t Metatile::MAX_TILES;
+
+Metatile::Metatile(const BoundingBox& tile) :
+    m_bbox(tile),
+    m_tiles{tile} {
+}
+
+void Metatile::add(const BoundingBox& tile) {
+    for (const BoundingBox& t : m_tiles) {
+        if (t.m_x == tile.m_x && t.m_y == tile.m_y && t.m_zoom == tile.m_zoom) {
+            return;
+        }
+    }
+    if (m_tiles.size() >= MAX_TILES) {
+        throw std::runtime_error{"Too many tiles in a metatile."};
+    }
+    m_bbox.m_min_lon = std::min(m_bbox.m_min_lon, tile.m_min_lon);
+    m_bbox.m_min_lat = std::min(m_bbox.m_min_lat, tile.m_min_lat);
+    m_bbox.m_max_lon = std::max(m_bbox.m_max_lon, tile.m_max_lon);
+    m_bbox.m_max_lat = std::max(m_bbox.m_max_lat, tile.m_max_lat);
+    m_tiles.push_back(tile);
+}
+
+const BoundingBox& Metatile::bbox() const {
+    return m_bbox;
+}
+
+const std::vector<BoundingBox>& Metatile::tiles() const {
+    return m_tiles;
+}
+
+/*static*/ std::vector<Metatile> Metatile::group(const std::vector<BoundingBox>& tiles, const int size) {
+    if (size < 1 || static_cast<size_t>(size * size) > MAX_TILES) {
+        throw std::runtime_error{"Invalid metatile size."};
+    }
+    std::vector<Metatile> metatiles;
+    // key is zoom level, x and y of the metatile, value is the index in metatiles
+    std::map<std::tuple<int, int, int>, size_t> index;
+    for (const BoundingBox& tile : tiles) {
+        std::tuple<int, int, int> key {tile.m_zoom, tile.m_x / size, tile.m_y / size};
+        auto it = index.find(key);
+        if (it == index.end()) {
+            index.emplace(key, metatiles.size());
+            metatiles.emplace_back(tile);
+        } else {
+            metatiles[it->second].add(tile);
+        }
+    }
+    return metatiles;
+}
+
+/*static*/ std::vector<Metatile> Metatile::group_pyramids(const std::vector<BoundingBox>& tiles) {
+    std::set<std::tuple<int, int, int>> present;
+    for (const BoundingBox& tile : tiles) {
+        present.emplace(tile.m_zoom, tile.m_x, tile.m_y);
+    }
+    std::vector<Metatile> metatiles;
+    // key is zoom level, x and y of the root tile, value is the index of the last group in metatiles
+    std::map<std::tuple<int, int, int>, size_t> index;
+    for (const BoundingBox& tile : tiles) {
+        std::tuple<int, int, int> root {tile.m_zoom, tile.m_x, tile.m_y};
+        for (int zoom = tile.m_zoom - 1; zoom >= 0; --zoom) {
+            const int shift = tile.m_zoom - zoom;
+            std::tuple<int, int, int> ancestor {zoom, tile.m_x >> shift, tile.m_y >> shift};
+            if (present.find(ancestor) != present.end()) {
+                root = ancestor;
+            }
+        }
+        auto it = index.find(root);
+        if (it == index.end() || metatiles[it->second].tiles().size() >= MAX_TILES) {
+            index[root] = metatiles.size();
+            metatiles.emplace_back(tile);
+        } else {
+            metatiles[it->second].add(tile);
+        }
+    }
+    return metatiles;
+}
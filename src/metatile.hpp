@@ -0,0 +1,84 @@
+/*
+ * metatile.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_METATILE_HPP_
+#define SRC_METATILE_HPP_
+
+#include <vector>
+#include "bounding_box.hpp"
+
+/**
+ * \brief Block of neighbouring tiles of the same zoom level whose data is fetched from the database at once
+ *
+ * The spatial queries use the union of the bounding boxes of all tiles. The database returns a bit
+ * mask per row which tells which tiles the row belongs to (see OSMDataTable::tile_mask_column()).
+ */
+class Metatile {
+    /// union of the bounding boxes of all tiles
+    BoundingBox m_bbox;
+
+    /// tiles of this metatile, the position is the bit of the tile in the tile mask
+    std::vector<BoundingBox> m_tiles;
+
+public:
+    /// maximum number of tiles of a metatile, limited by the size of the tile mask
+    static const size_t MAX_TILES = 64;
+
+    /**
+     * \brief Create a metatile containing a single tile.
+     */
+    explicit Metatile(const BoundingBox& tile);
+
+    /**
+     * \brief Add a tile and extend the bounding box of the metatile.
+     *
+     * Tiles which are part of the metatile already are ignored.
+     *
+     * \throws std::runtime_error if the metatile is full
+     */
+    void add(const BoundingBox& tile);
+
+    /**
+     * \brief union of the bounding boxes of all tiles
+     */
+    const BoundingBox& bbox() const;
+
+    /**
+     * \brief tiles of this metatile in the order they were added
+     */
+    const std::vector<BoundingBox>& tiles() const;
+
+    /**
+     * \brief Group a list of tiles into metatiles of up to size x size tiles.
+     *
+     * Tiles of the same zoom level are grouped if they belong to the same block of size x size tiles.
+     * The metatiles are ordered by the first occurence of one of their tiles in the list. Tiles keep
+     * their relative order inside a metatile.
+     *
+     * \param tiles tiles to group
+     * \param size width and height of a metatile in tiles, at most 8
+     *
+     * \returns metatiles
+     */
+    static std::vector<Metatile> group(const std::vector<BoundingBox>& tiles, const int size);
+
+    /**
+     * \brief Group a list of tiles with the tiles of lower zoom levels containing them.
+     *
+     * The root of a group is the tile of the lowest zoom level in the list which contains the
+     * other tiles of the group. Its bounding box (including the buffer) contains the bounding boxes
+     * of all tiles below it. Groups with more than #MAX_TILES tiles are split.
+     * The groups are ordered by the first occurence of one of their tiles in the list.
+     *
+     * \param tiles tiles to group
+     *
+     * \returns groups of tiles
+     */
+    static std::vector<Metatile> group_pyramids(const std::vector<BoundingBox>& tiles);
+};
+
+#endif /* SRC_METATILE_HPP_ */
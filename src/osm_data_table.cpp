@@ -6,7 +6,15 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <boost/format.hpp>
 #include "osm_data_table.hpp"
+#include "binary_result.hpp"
+#include "tile_cost.hpp"
+
+const size_t OSMDataTable::ID_ARRAY_BATCH_SIZE;
 
 OSMDataTable::OSMDataTable(const char* table_name, postgres_drivers::Config& config, postgres_drivers::Columns&& columns) :
         postgres_drivers::Table(table_name, config, columns),
@@ -16,7 +24,179 @@ OSMDataTable::OSMDataTable(const char* table_name, postgres_drivers::Config& con
     m_max_lat(new char[25]) {
 }
 
+OSMDataTable::OSMDataTable(const char* table_name, postgres_drivers::Config& config, postgres_drivers::Columns&& columns,
+        PGconn* connection) :
+        // This constructor of postgres_drivers::Table does not connect to the database.
+        postgres_drivers::Table(columns, config),
+    m_min_lon(new char[25]),
+    m_min_lat(new char[25]),
+    m_max_lon(new char[25]),
+    m_max_lat(new char[25]),
+    m_shared_connection(true) {
+    m_name = table_name;
+    m_database_connection = connection;
+}
+
+OSMDataTable::~OSMDataTable() {
+    // postgres_drivers::Table closes its connection, PQfinish(nullptr) does nothing.
+    if (m_shared_connection) {
+        m_database_connection = nullptr;
+    }
+}
+
+std::string OSMDataTable::statement_name(const char* name) const {
+    std::string result = m_name;
+    result.push_back('.');
+    result.append(name);
+    return result;
+}
+
+void OSMDataTable::create_prepared_statement(const char* name, std::string query, int params_count,
+        const ResultFormat format) {
+    postgres_drivers::Table::create_prepared_statement(statement_name(name).c_str(), query, params_count);
+    m_result_formats[name] = format;
+}
+
+int OSMDataTable::result_format(const char* name) const {
+    auto it = m_result_formats.find(name);
+    if (it == m_result_formats.end()) {
+        return static_cast<int>(ResultFormat::TEXT);
+    }
+    return static_cast<int>(it->second);
+}
+
+void OSMDataTable::create_source_state_statement(const std::string& condition) {
+    std::string query = (boost::format("SELECT count(*)::text, max(osm_lastmodified)::text FROM %1% WHERE %2%")
+            % m_name % bbox_condition(condition)).str();
+    create_prepared_statement("get_source_state", query, 4);
+}
+
+std::string OSMDataTable::source_state(const BoundingBox& bbox) {
+    // formatted like set_bbox_parameters()
+    char coordinates[4][25];
+    sprintf(coordinates[0], "%f", bbox.m_min_lon);
+    sprintf(coordinates[1], "%f", bbox.m_min_lat);
+    sprintf(coordinates[2], "%f", bbox.m_max_lon);
+    sprintf(coordinates[3], "%f", bbox.m_max_lat);
+    const char* const params[4] = {coordinates[0], coordinates[1], coordinates[2], coordinates[3]};
+    PGresult* result = run_prepared_statement("get_source_state", 4, params);
+    std::string state = PQgetvalue(result, 0, 0);
+    state.push_back('/');
+    state += PQgetvalue(result, 0, 1);
+    PQclear(result);
+    return state;
+}
+
+double OSMDataTable::estimate_rows(const char* name, const BoundingBox& bbox) {
+    // formatted like set_bbox_parameters() and set_metatile()
+    char coordinates[4][25];
+    sprintf(coordinates[0], "%f", bbox.m_min_lon);
+    sprintf(coordinates[1], "%f", bbox.m_min_lat);
+    sprintf(coordinates[2], "%f", bbox.m_max_lon);
+    sprintf(coordinates[3], "%f", bbox.m_max_lat);
+    char* statement = PQescapeIdentifier(m_database_connection, statement_name(name).c_str(),
+            statement_name(name).size());
+    if (!statement) {
+        throw std::runtime_error{PQerrorMessage(m_database_connection)};
+    }
+    std::string query = (boost::format("EXPLAIN EXECUTE %1%('%2%', '%3%', '%4%', '%5%'") % statement
+            % coordinates[0] % coordinates[1] % coordinates[2] % coordinates[3]).str();
+    PQfreemem(statement);
+    if (m_metatiles) {
+        // a metatile consisting of this tile only
+        query += (boost::format(", '{%1%,%2%,%3%,%4%}'") % coordinates[0] % coordinates[1] % coordinates[2]
+                % coordinates[3]).str();
+    }
+    query.push_back(')');
+    PGresult* result = PQexec(m_database_connection, query.c_str());
+    check_prepared_statement_execution(result);
+    if (PQntuples(result) < 1) {
+        PQclear(result);
+        throw std::runtime_error{(boost::format("Empty query plan of %1%") % statement_name(name)).str()};
+    }
+    // The first line describes the top node of the plan.
+    std::string plan = PQgetvalue(result, 0, 0);
+    PQclear(result);
+    return tile_cost::plan_rows(plan.c_str());
+}
+
+void OSMDataTable::set_chunk_size(const int chunk_size) {
+    m_chunk_size = chunk_size;
+}
+
+void OSMDataTable::enable_metatiles() {
+    m_metatiles = true;
+}
+
+int OSMDataTable::bbox_parameter_count() const {
+    return m_metatiles ? 5 : 4;
+}
+
+/*static*/ std::string OSMDataTable::bbox_condition(const std::string& condition) {
+    return (boost::format(condition) % "ST_MakeEnvelope($1, $2, $3, $4, 4326)").str();
+}
+
+std::string OSMDataTable::tile_mask_column(const std::string& condition) const {
+    if (!m_metatiles) {
+        return "";
+    }
+    // The fifth parameter contains four coordinates per tile.
+    std::string envelope = "ST_MakeEnvelope(($5::float8[])[i + 1], ($5::float8[])[i + 2], ($5::float8[])[i + 3]," \
+            " ($5::float8[])[i + 4], 4326)";
+    std::string query = ", (SELECT COALESCE(bit_or(1::bigint << (i / 4)), 0)" \
+            " FROM generate_series(0, array_length($5::float8[], 1) - 4, 4) AS i WHERE %1%) AS tile_mask";
+    return (boost::format(query) % (boost::format(condition) % envelope).str()).str();
+}
+
+void OSMDataTable::set_latency_callback(latency_callback_type callback) {
+    m_latency_callback = callback;
+}
+
+void OSMDataTable::report_latency() {
+    if (m_latency_pending) {
+        m_latency_pending = false;
+        m_latency_callback(std::chrono::steady_clock::now() - m_sent_time);
+    }
+}
+
 void OSMDataTable::set_bbox(const BoundingBox& bbox) {
+    if (!m_metatiles) {
+        set_bbox_parameters(bbox);
+        return;
+    }
+    for (size_t i = 0; i < m_metatile_tiles.size(); ++i) {
+        const BoundingBox& tile = m_metatile_tiles[i];
+        if (tile.m_x == bbox.m_x && tile.m_y == bbox.m_y && tile.m_zoom == bbox.m_zoom) {
+            m_metatile_tile = i;
+            return;
+        }
+    }
+    set_metatile(Metatile{bbox});
+}
+
+void OSMDataTable::set_metatile(const Metatile& metatile) {
+    assert(m_metatiles);
+    set_bbox_parameters(metatile.bbox());
+    m_metatile_tiles = metatile.tiles();
+    m_metatile_tile = 0;
+    m_metatile_results.clear();
+    // The coordinates are formatted the same way as the bounding box parameters. Otherwise,
+    // rows at the edges of a tile could differ from a query for the single tile.
+    char coordinate[25];
+    m_tile_envelopes = "{";
+    for (const BoundingBox& tile : m_metatile_tiles) {
+        for (const double value : {tile.m_min_lon, tile.m_min_lat, tile.m_max_lon, tile.m_max_lat}) {
+            if (m_tile_envelopes.size() > 1) {
+                m_tile_envelopes.push_back(',');
+            }
+            sprintf(coordinate, "%f", value);
+            m_tile_envelopes.append(coordinate);
+        }
+    }
+    m_tile_envelopes.push_back('}');
+}
+
+void OSMDataTable::set_bbox_parameters(const BoundingBox& bbox) {
     sprintf(m_min_lon.get(), "%f", bbox.m_min_lon);
     sprintf(m_min_lat.get(), "%f", bbox.m_min_lat);
     sprintf(m_max_lon.get(), "%f", bbox.m_max_lon);
@@ -47,7 +227,8 @@ void OSMDataTable::check_prepared_statement_execution(PGresult* result) {
 
 PGresult* OSMDataTable::run_prepared_statement(const char* name, int param_count, const char* const * param_values) {
     assert(m_database_connection);
-    PGresult* result = PQexecPrepared(m_database_connection, name, param_count, param_values, nullptr, nullptr, 0);
+    PGresult* result = PQexecPrepared(m_database_connection, statement_name(name).c_str(), param_count, param_values, nullptr, nullptr,
+            result_format(name));
     check_prepared_statement_execution(result);
     return result;
 }
@@ -57,7 +238,318 @@ PGresult* OSMDataTable::run_prepared_bbox_statement(const char* name) {
 #ifndef NDEBUG
     assert(m_valid_bbox && "You must set the bounding box parameters before you can run queries!");
 #endif
-    PGresult* result = PQexecPrepared(m_database_connection, name, 4, m_bbox_parameters, nullptr, nullptr, 0);
+    assert(!m_metatiles && "Use the callback-based methods if metatiles are enabled!");
+    m_sent_time = std::chrono::steady_clock::now();
+    m_latency_pending = static_cast<bool>(m_latency_callback);
+    PGresult* result = PQexecPrepared(m_database_connection, statement_name(name).c_str(), 4, m_bbox_parameters, nullptr, nullptr,
+            result_format(name));
+    report_latency();
     check_prepared_statement_execution(result);
     return result;
 }
+
+/*static*/ void OSMDataTable::call_and_clear(std::function<void(PGresult*)>& callback, PGresult* result) {
+    try {
+        callback(result);
+    } catch (...) {
+        PQclear(result);
+        throw;
+    }
+    PQclear(result);
+}
+
+void OSMDataTable::cancel_and_discard_results() {
+    PGcancel* cancel = PQgetCancel(m_database_connection);
+    if (cancel) {
+        char error_buffer[256];
+        PQcancel(cancel, error_buffer, sizeof(error_buffer));
+        PQfreeCancel(cancel);
+    }
+    while (PGresult* result = PQgetResult(m_database_connection)) {
+        PQclear(result);
+    }
+}
+
+/*static*/ void OSMDataTable::append_row(PGresult* chunk, const PGresult* source, const int row) {
+    const int row_number = PQntuples(chunk);
+    const int field_count = PQnfields(source);
+    for (int j = 0; j < field_count; ++j) {
+        int ok;
+        if (PQgetisnull(source, row, j)) {
+            ok = PQsetvalue(chunk, row_number, j, nullptr, -1);
+        } else {
+            ok = PQsetvalue(chunk, row_number, j, PQgetvalue(source, row, j), PQgetlength(source, row, j));
+        }
+        if (!ok) {
+            throw std::runtime_error{"Failed to copy row of query result, out of memory."};
+        }
+    }
+}
+
+void OSMDataTable::send_prepared_bbox_statement(const char* name) {
+    assert(m_database_connection);
+#ifndef NDEBUG
+    assert(m_valid_bbox && "You must set the bounding box parameters before you can run queries!");
+#endif
+    m_pending_statement = name;
+    if (m_metatiles && m_metatile_results.find(m_pending_statement) != m_metatile_results.end()) {
+        // The result of the metatile has been received already.
+        return;
+    }
+    const char* param_values[5] = {m_bbox_parameters[0], m_bbox_parameters[1], m_bbox_parameters[2],
+            m_bbox_parameters[3], m_tile_envelopes.c_str()};
+    if (!PQsendQueryPrepared(m_database_connection, statement_name(name).c_str(), bbox_parameter_count(), param_values,
+            nullptr, nullptr, result_format(name))) {
+        throw std::runtime_error{(boost::format("Failed to send query %1%: %2%\n") % name
+                % PQerrorMessage(m_database_connection)).str()};
+    }
+    m_sent_time = std::chrono::steady_clock::now();
+    m_latency_pending = static_cast<bool>(m_latency_callback);
+    // The results of metatiles are kept completely, streaming would not save memory.
+    if (m_chunk_size <= 0 || m_metatiles) {
+        return;
+    }
+    // Chunked rows mode is available since PostgreSQL 17. Older versions of libpq return one result
+    // per row in single-row mode. These rows are collected into chunks before calling the callback.
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    const bool single_row_mode = !PQsetChunkedRowsMode(m_database_connection, m_chunk_size);
+#else
+    constexpr bool single_row_mode = true;
+#endif
+    if (single_row_mode && !PQsetSingleRowMode(m_database_connection)) {
+        cancel_and_discard_results();
+        throw std::runtime_error{(boost::format("Failed to enable single-row mode for query %1%\n") % name).str()};
+    }
+}
+
+void OSMDataTable::receive_results(std::function<void(PGresult*)> callback) {
+    if (!m_metatiles) {
+        receive_chunks([&](PGresult* chunk) {
+            call_and_clear(callback, chunk);
+        });
+        return;
+    }
+    auto it = m_metatile_results.find(m_pending_statement);
+    if (it == m_metatile_results.end()) {
+        std::vector<result_ptr> results;
+        receive_chunks([&](PGresult* chunk) {
+            result_ptr ptr {chunk, PQclear};
+            results.push_back(std::move(ptr));
+        });
+        it = m_metatile_results.emplace(m_pending_statement, std::move(results)).first;
+    }
+    for (result_ptr& result : it->second) {
+        PGresult* rows = tile_rows(result.get());
+        if (PQntuples(rows) > 0) {
+            call_and_clear(callback, rows);
+        } else {
+            PQclear(rows);
+        }
+    }
+}
+
+PGresult* OSMDataTable::tile_rows(const PGresult* result) const {
+    const int mask_field = PQnfields(result) - 1;
+    const bool binary = PQfformat(result, mask_field) == 1;
+    PGresult* rows = PQcopyResult(result, PG_COPYRES_ATTRS);
+    if (!rows) {
+        throw std::runtime_error{"Failed to copy query result, out of memory."};
+    }
+    const int tuple_count = PQntuples(result);
+    try {
+        for (int i = 0; i < tuple_count; ++i) {
+            uint64_t mask = binary ? binary_result::get_int8(result, i, mask_field)
+                    : strtoull(PQgetvalue(result, i, mask_field), nullptr, 10);
+            if ((mask >> m_metatile_tile) & 1) {
+                append_row(rows, result, i);
+            }
+        }
+    } catch (...) {
+        PQclear(rows);
+        throw;
+    }
+    return rows;
+}
+
+void OSMDataTable::receive_chunks(std::function<void(PGresult*)> consumer) {
+    assert(m_database_connection);
+    PGresult* chunk = nullptr;
+    try {
+        while (PGresult* result = PQgetResult(m_database_connection)) {
+            report_latency();
+            ExecStatusType status = PQresultStatus(result);
+            if (status == PGRES_SINGLE_TUPLE) {
+                if (!chunk) {
+                    chunk = PQcopyResult(result, PG_COPYRES_ATTRS);
+                }
+                append_row(chunk, result);
+                PQclear(result);
+                if (PQntuples(chunk) >= m_chunk_size) {
+                    PGresult* full_chunk = chunk;
+                    chunk = nullptr;
+                    consumer(full_chunk);
+                }
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            } else if (status == PGRES_TUPLES_CHUNK) {
+                consumer(result);
+#endif
+            } else if (status == PGRES_TUPLES_OK && PQntuples(result) > 0) {
+                // complete result of a query which was not streamed
+                consumer(result);
+            } else if (status == PGRES_TUPLES_OK) {
+                // end of a streamed result set, contains no rows
+                PQclear(result);
+                if (chunk) {
+                    PGresult* last_chunk = chunk;
+                    chunk = nullptr;
+                    consumer(last_chunk);
+                }
+            } else {
+                std::string message = "Failed: ";
+                message += PQresultErrorMessage(result);
+                message += "\n";
+                PQclear(result);
+                throw std::runtime_error(message);
+            }
+        }
+    } catch (...) {
+        if (chunk) {
+            PQclear(chunk);
+        }
+        cancel_and_discard_results();
+        throw;
+    }
+}
+
+void OSMDataTable::run_prepared_bbox_statement(const char* name, std::function<void(PGresult*)> callback) {
+    send_prepared_bbox_statement(name);
+    receive_results(callback);
+}
+
+PGresult* OSMDataTable::run_prepared_id_array_statement(const char* name,
+        std::vector<osmium::object_id_type>::const_iterator begin,
+        std::vector<osmium::object_id_type>::const_iterator end) {
+    assert(m_database_connection);
+    // The array is sent in binary format. This saves formatting and parsing it.
+    std::string id_array = binary_result::encode_int8_array(begin, end);
+    const char* param_values[1] = {id_array.data()};
+    const int param_lengths[1] = {static_cast<int>(id_array.size())};
+    const int param_formats[1] = {1};
+    PGresult* result = PQexecPrepared(m_database_connection, statement_name(name).c_str(), 1, param_values, param_lengths,
+            param_formats, result_format(name));
+    check_prepared_statement_execution(result);
+    return result;
+}
+
+bool OSMDataTable::send_prepared_id_array_statement(const char* name,
+        std::vector<osmium::object_id_type>::const_iterator begin,
+        std::vector<osmium::object_id_type>::const_iterator end) {
+    assert(m_database_connection);
+    std::string id_array = binary_result::encode_int8_array(begin, end);
+    const char* param_values[1] = {id_array.data()};
+    const int param_lengths[1] = {static_cast<int>(id_array.size())};
+    const int param_formats[1] = {1};
+    return PQsendQueryPrepared(m_database_connection, statement_name(name).c_str(), 1, param_values, param_lengths,
+            param_formats, result_format(name));
+}
+
+void OSMDataTable::run_prepared_id_array_statement(const char* name,
+        const std::vector<osmium::object_id_type>& ids, std::function<void(PGresult*)> callback) {
+    std::vector<IdArrayQuery> queries {{*this, name, ids, callback}};
+    run_prepared_id_array_statements(queries);
+}
+
+/*static*/ bool OSMDataTable::pipeline_supported(PGconn* connection) {
+#ifdef LIBPQ_HAS_PIPELINING
+    return PQserverVersion(connection) >= 140000;
+#else
+    return false;
+#endif
+}
+
+/*static*/ void OSMDataTable::run_prepared_id_array_statements(std::vector<IdArrayQuery>& queries) {
+    // split queries into batches
+    struct Batch {
+        IdArrayQuery& query;
+        std::vector<osmium::object_id_type>::const_iterator begin;
+        std::vector<osmium::object_id_type>::const_iterator end;
+    };
+    std::vector<Batch> batches;
+    bool same_connection = true;
+    for (IdArrayQuery& query : queries) {
+        same_connection = same_connection
+                && query.table.m_database_connection == queries.front().table.m_database_connection;
+        for (auto batch_begin = query.ids.cbegin(); batch_begin != query.ids.cend();) {
+            auto batch_end = batch_begin + std::min<size_t>(ID_ARRAY_BATCH_SIZE, query.ids.cend() - batch_begin);
+            batches.push_back(Batch{query, batch_begin, batch_end});
+            batch_begin = batch_end;
+        }
+    }
+    if (batches.size() < 2 || !same_connection
+            || !pipeline_supported(queries.front().table.m_database_connection)) {
+        for (Batch& batch : batches) {
+            call_and_clear(batch.query.callback, batch.query.table.run_prepared_id_array_statement(
+                    batch.query.name, batch.begin, batch.end));
+        }
+        return;
+    }
+#ifdef LIBPQ_HAS_PIPELINING
+    PGconn* connection = queries.front().table.m_database_connection;
+    for (size_t round_begin = 0; round_begin < batches.size(); round_begin += PIPELINE_DEPTH) {
+        const size_t round_end = std::min(round_begin + PIPELINE_DEPTH, batches.size());
+        if (!PQenterPipelineMode(connection)) {
+            throw std::runtime_error{(boost::format("Failed to enter pipeline mode: %1%\n")
+                    % PQerrorMessage(connection)).str()};
+        }
+        std::string error;
+        size_t sent = round_begin;
+        for (; sent < round_end; ++sent) {
+            Batch& batch = batches[sent];
+            if (!batch.query.table.send_prepared_id_array_statement(batch.query.name, batch.begin, batch.end)) {
+                error = PQerrorMessage(connection);
+                break;
+            }
+        }
+        PQpipelineSync(connection);
+        // Receive all results before calling any callback. The connection has to leave pipeline
+        // mode before the callbacks may send their own queries.
+        std::vector<PGresult*> results;
+        results.reserve(sent - round_begin);
+        for (size_t i = round_begin; i < sent; ++i) {
+            PGresult* result = PQgetResult(connection);
+            ExecStatusType status = PQresultStatus(result);
+            if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+                if (error.empty()) {
+                    error = PQresultErrorMessage(result);
+                }
+                PQclear(result);
+                result = nullptr;
+            }
+            results.push_back(result);
+            // Each query of a pipeline is terminated by a null pointer.
+            PQgetResult(connection);
+        }
+        PGresult* sync_result = PQgetResult(connection);
+        PQclear(sync_result);
+        PQexitPipelineMode(connection);
+        if (!error.empty()) {
+            for (PGresult* result : results) {
+                PQclear(result);
+            }
+            throw std::runtime_error{"Failed: " + error + "\n"};
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            PGresult* result = results[i];
+            results[i] = nullptr;
+            try {
+                call_and_clear(batches[round_begin + i].query.callback, result);
+            } catch (...) {
+                for (PGresult* remaining : results) {
+                    PQclear(remaining);
+                }
+                throw;
+            }
+        }
+    }
+#endif
+}
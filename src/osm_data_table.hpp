@@ -9,8 +9,26 @@
 #define SRC_OSM_DATA_TABLE_HPP_
 
 #include <libpq-fe.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <osmium/osm/types.hpp>
 #include <postgres_drivers/table.hpp>
 #include "bounding_box.hpp"
+#include "metatile.hpp"
+
+/**
+ * \brief format of the results of a prepared statement
+ */
+enum class ResultFormat : int {
+    /// text representation, fields are null-terminated strings
+    TEXT = 0,
+    /// binary representation, use the accessors in binary_result.hpp to read fields
+    BINARY = 1
+};
 
 /**
  * \brief This class extends the features offered by the postgres-drivers library.
@@ -24,6 +42,10 @@
  */
 
 class OSMDataTable : public postgres_drivers::Table {
+public:
+    /// callback receiving the latency of a spatial query
+    using latency_callback_type = std::function<void(std::chrono::steady_clock::duration)>;
+
 private:
     /**
      * \brief array which contains pointers to the four parameters of the bounding box used
@@ -35,6 +57,54 @@ private:
     std::unique_ptr<char> m_max_lon;
     std::unique_ptr<char> m_max_lat;
 
+    /// result format of each prepared statement, key is the name of the statement
+    std::map<std::string, ResultFormat> m_result_formats;
+
+    /**
+     * \brief maximum number of rows passed to the callback of receive_results() at once, 0 disables streaming
+     */
+    int m_chunk_size = 0;
+
+    /// true if spatial queries return a tile mask, see enable_metatiles()
+    bool m_metatiles = false;
+
+    /**
+     * \brief envelopes of the tiles of the current metatile as PostgreSQL array,
+     * fifth parameter of spatial queries if metatiles are enabled
+     */
+    std::string m_tile_envelopes;
+
+    /// tiles of the current metatile
+    std::vector<BoundingBox> m_metatile_tiles;
+
+    /// index of the tile of the current metatile whose rows are returned by receive_results()
+    size_t m_metatile_tile = 0;
+
+    using result_ptr = std::unique_ptr<PGresult, void(*)(PGresult*)>;
+
+    /// results of spatial queries for the current metatile, key is the name of the statement
+    std::map<std::string, std::vector<result_ptr>> m_metatile_results;
+
+    /// name of the spatial query whose result is received by the next call of receive_results()
+    std::string m_pending_statement;
+
+    /// callback receiving the latency of spatial queries, may be empty
+    latency_callback_type m_latency_callback;
+
+    /// time when the pending spatial query was sent, used to measure its latency
+    std::chrono::steady_clock::time_point m_sent_time;
+
+    /// true if the latency of the pending spatial query has not been reported yet
+    bool m_latency_pending = false;
+
+    /// true if the database connection is owned by a ConnectionManager and must not be closed by this table
+    bool m_shared_connection = false;
+
+    /**
+     * \brief Report the latency of the pending spatial query if it has not been reported yet.
+     */
+    void report_latency();
+
 #ifndef NDEBUG
     /**
      * Check if bounding box parameters are valid. This check is not done in release builds
@@ -50,16 +120,218 @@ private:
      */
     void check_prepared_statement_execution(PGresult* result);
 
+    /**
+     * \brief Get the name of a prepared statement on the database connection.
+     *
+     * The name is prefixed by the table name because multiple tables may share a connection.
+     */
+    std::string statement_name(const char* name) const;
+
+    /**
+     * \brief Get the result format of a prepared statement as expected by libpq.
+     */
+    int result_format(const char* name) const;
+
+    /**
+     * \brief Append a row of a result to a chunk of rows.
+     *
+     * \param chunk result to append the row to
+     * \param source result containing the row
+     * \param row number of the row in the source result, results retrieved in single-row mode
+     *        contain only row 0
+     *
+     * \throws std::runtime_error if libpq runs out of memory
+     */
+    static void append_row(PGresult* chunk, const PGresult* source, const int row = 0);
+
+    /**
+     * \brief Set the parameters of spatial queries to a bounding box.
+     */
+    void set_bbox_parameters(const BoundingBox& bbox);
+
+    /**
+     * \brief Receive the results of the query sent last.
+     *
+     * See receive_results() for the handling of chunks.
+     *
+     * \param consumer function called with each chunk, it gets ownership of the chunk
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void receive_chunks(std::function<void(PGresult*)> consumer);
+
+    /**
+     * \brief Copy the rows of a result of a spatial query which belong to the current tile of the metatile.
+     *
+     * The tile mask is read from the last column.
+     *
+     * \returns copy of the rows. You get ownership of the memory and have to call PQclear(PGresult*) to destroy it.
+     *
+     * \throws std::runtime_error if libpq runs out of memory
+     */
+    PGresult* tile_rows(const PGresult* result) const;
+
+    /**
+     * \brief Call a callback with a result and free the result afterwards, even if the callback throws.
+     */
+    static void call_and_clear(std::function<void(PGresult*)>& callback, PGresult* result);
+
+    /**
+     * \brief Send a prepared statement whose only parameter is an array of OSM object IDs
+     * without waiting for its result.
+     *
+     * \returns false if sending failed
+     */
+    bool send_prepared_id_array_statement(const char* name,
+            std::vector<osmium::object_id_type>::const_iterator begin,
+            std::vector<osmium::object_id_type>::const_iterator end);
+
+    /**
+     * \brief Check if pipeline mode can be used on a connection.
+     *
+     * Pipeline mode requires libpq and the server to be version 14 or newer.
+     */
+    static bool pipeline_supported(PGconn* connection);
+
 public:
     OSMDataTable(const char* table_name, postgres_drivers::Config& config, postgres_drivers::Columns&& columns);
 
+    /**
+     * \brief Create a table using an existing database connection.
+     *
+     * The connection can be shared with other tables and has to outlive this table,
+     * see ConnectionManager.
+     */
+    OSMDataTable(const char* table_name, postgres_drivers::Config& config, postgres_drivers::Columns&& columns,
+            PGconn* connection);
+
+    OSMDataTable(OSMDataTable&& other) = default;
+
+    /**
+     * \brief Close the database connection unless it is shared.
+     */
+    ~OSMDataTable();
+
+    /**
+     * \brief create a prepared statement
+     *
+     * \param name name of the prepared statement
+     * \param query template query of this statement
+     * \param params_count number of argument of this query
+     * \param format format of the results returned when the statement is executed
+     */
+    void create_prepared_statement(const char* name, std::string query, int params_count,
+            const ResultFormat format = ResultFormat::TEXT);
+
+    /**
+     * \brief Set the maximum number of rows of a result of a spatial query which are held in memory at once.
+     *
+     * \param chunk_size number of rows, 0 disables streaming
+     */
+    void set_chunk_size(const int chunk_size);
+
+    /**
+     * \brief Let spatial queries return the rows of all tiles of a metatile at once.
+     *
+     * Spatial queries have to select tile_mask_column() as their last column and take the
+     * envelopes of the tiles as fifth parameter (see bbox_parameter_count()). Therefore, this method
+     * has to be called before the prepared statements are created.
+     */
+    void enable_metatiles();
+
+    /**
+     * \brief Get the number of parameters of spatial queries.
+     *
+     * \returns 5 if metatiles are enabled, 4 otherwise
+     */
+    int bbox_parameter_count() const;
+
+    /**
+     * \brief Build the condition of the WHERE clause of a spatial query.
+     *
+     * \param condition spatial condition, `%1%` is replaced by the envelope of the bounding box
+     *
+     * \returns condition using the parameters $1 to $4
+     */
+    static std::string bbox_condition(const std::string& condition);
+
+    /**
+     * \brief Build the column of a spatial query which contains the tile mask if metatiles are enabled.
+     *
+     * Bit i of the tile mask is set if the row intersects the i-th tile of the metatile.
+     *
+     * \param condition spatial condition, `%1%` is replaced by the envelope of a tile
+     *
+     * \returns column definition including a leading comma or an empty string if metatiles are not enabled
+     */
+    std::string tile_mask_column(const std::string& condition) const;
+
+    /**
+     * \brief Create a prepared statement summarizing the rows of a tile for change detection.
+     *
+     * The statement returns the number of rows matching the spatial condition and the latest
+     * modification timestamp (column `osm_lastmodified`) of these rows. See source_state().
+     *
+     * \param condition spatial condition, `%1%` is replaced by the envelope of the tile
+     */
+    void create_source_state_statement(const std::string& condition);
+
+    /**
+     * \brief Summarize the rows of a tile using the statement created by create_source_state_statement().
+     *
+     * The current bounding box and metatile are not changed.
+     *
+     * \param bbox bounding box of the tile
+     *
+     * \returns `COUNT/TIMESTAMP`, timestamp is empty if there are no rows
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    std::string source_state(const BoundingBox& bbox);
+
+    /**
+     * \brief Get the number of rows the query planner expects a spatial prepared statement to return for a tile.
+     *
+     * The statement is explained using EXPLAIN EXECUTE. It is not executed. The current bounding box
+     * and metatile are not changed.
+     *
+     * \param name name of the prepared statement
+     * \param bbox bounding box of the tile
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    double estimate_rows(const char* name, const BoundingBox& bbox);
+
+    /**
+     * \brief Set a callback receiving the latency of each spatial query.
+     *
+     * The latency is the time between sending the query and receiving the first rows (or the
+     * complete result if results are not streamed). Queries whose result is taken from the
+     * current metatile are not reported.
+     */
+    void set_latency_callback(latency_callback_type callback);
+
     /**
      * set/change the bounding box which is currently used
      *
+     * If metatiles are enabled and the tile belongs to the current metatile, spatial queries return
+     * the rows of this tile from the results of the metatile. Otherwise, the tile replaces
+     * the current metatile.
+     *
      * \param bbox reference to an instance of BoudingBox
      */
     void set_bbox(const BoundingBox& bbox);
 
+    /**
+     * \brief Set the metatile whose data is queried by spatial queries.
+     *
+     * Spatial queries are executed once for the whole metatile. Select the tile whose rows are
+     * returned using set_bbox(). Metatiles have to be enabled.
+     *
+     * \param metatile metatile
+     */
+    void set_metatile(const Metatile& metatile);
+
     /**
      * \brief Get a pointer to the array of bounding box parameters.
      *
@@ -70,7 +342,7 @@ public:
     /**
      * \brief execute a prepared statement
      *
-     * The statement has to be registered first using postgres_drivers::Table::create_prepared_statement(const char*, std::string, int).
+     * The statement has to be registered first using create_prepared_statement(const char*, std::string, int, const ResultFormat).
      *
      * \param name name of the prepared statement
      * \param param_count number of parameters of this prepared statement
@@ -83,8 +355,9 @@ public:
     /**
      * \brief execute a prepared statement using a spatial query
      *
-     * The statement has to be registered first using postgres_drivers::Table::create_prepared_statement(const char*, std::string, int).
+     * The statement has to be registered first using create_prepared_statement(const char*, std::string, int, const ResultFormat).
      * It must have only four parameters and its where clause should only contain one condition: ST_Intersects()
+     * This method cannot be used if metatiles are enabled.
      *
      * \param name name of the prepared statement
      *
@@ -92,6 +365,135 @@ public:
      */
     PGresult* run_prepared_bbox_statement(const char* name);
 
+    /**
+     * \brief send a prepared statement using a spatial query without waiting for its result
+     *
+     * Use receive_results() to process the result. No other query can be sent on the database
+     * connection of this table until the result has been received. Use tables with different
+     * connections to run multiple queries at the same time.
+     *
+     * If metatiles are enabled and the query has been executed for the current metatile already,
+     * nothing is sent.
+     *
+     * \param name name of the prepared statement
+     *
+     * \throws std::runtime_error if the query cannot be sent
+     */
+    void send_prepared_bbox_statement(const char* name);
+
+    /**
+     * \brief receive the result of a query sent by send_prepared_bbox_statement()
+     *
+     * If a chunk size is set, the rows are fetched from the server while the query is still running
+     * and the callback is called for every chunk of up to chunk size rows. Peak memory usage
+     * therefore depends on the chunk size instead of the size of the result. Otherwise, the
+     * callback is called once with the complete result (it is not called for empty results).
+     *
+     * If metatiles are enabled, the complete result of the metatile is kept and only the rows of
+     * the current tile are passed to the callback. Results are not streamed in this case.
+     *
+     * Do not send any queries using this table from inside the callback.
+     *
+     * \param callback function called with each chunk. The chunk is freed after the callback
+     *        returns or throws.
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void receive_results(std::function<void(PGresult*)> callback);
+
+    /**
+     * \brief Cancel the query currently running on the connection and discard its pending results.
+     *
+     * Call this method if a result sent by send_prepared_bbox_statement() will not be received
+     * because of an error.
+     */
+    void cancel_and_discard_results();
+
+    /**
+     * \brief execute a prepared statement using a spatial query and stream its result
+     *
+     * This is a shortcut for send_prepared_bbox_statement() followed by receive_results().
+     *
+     * \param name name of the prepared statement
+     * \param callback function called with each chunk. The chunk is freed after the callback
+     *        returns or throws.
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void run_prepared_bbox_statement(const char* name, std::function<void(PGresult*)> callback);
+
+    /**
+     * \brief maximum number of IDs passed to a prepared statement at once by
+     * run_prepared_id_array_statement()
+     */
+    static const size_t ID_ARRAY_BATCH_SIZE = 10000;
+
+    /**
+     * \brief execute a prepared statement whose only parameter is an array of OSM object IDs
+     *
+     * The statement has to be registered first using create_prepared_statement(const char*, std::string, int, const ResultFormat).
+     * Its only parameter has to be of type `bigint[]`, e.g. `WHERE osm_id = ANY($1::bigint[])`.
+     * The array is passed in binary format.
+     *
+     * \param name name of the prepared statement
+     * \param begin iterator pointing to the first ID to query
+     * \param end iterator pointing behind the last ID to query
+     *
+     * \returns result of the query. You get ownership of the memory and have to call PQclear(PGresult*) to destroy it.
+     */
+    PGresult* run_prepared_id_array_statement(const char* name,
+            std::vector<osmium::object_id_type>::const_iterator begin,
+            std::vector<osmium::object_id_type>::const_iterator end);
+
+    /**
+     * \brief execute a prepared statement whose only parameter is an array of OSM object IDs
+     * for all IDs in batches of up to #ID_ARRAY_BATCH_SIZE IDs
+     *
+     * \param name name of the prepared statement
+     * \param ids IDs to query
+     * \param callback function called with the result of each batch. The result is freed
+     *        after the callback returns or throws.
+     */
+    void run_prepared_id_array_statement(const char* name, const std::vector<osmium::object_id_type>& ids,
+            std::function<void(PGresult*)> callback);
+
+    /**
+     * \brief query whose only parameter is an array of OSM object IDs, see run_prepared_id_array_statements()
+     */
+    struct IdArrayQuery {
+        /// table whose prepared statement is executed
+        OSMDataTable& table;
+        /// name of the prepared statement
+        const char* name;
+        /// IDs to query
+        const std::vector<osmium::object_id_type>& ids;
+        /// function called with the result of each batch
+        std::function<void(PGresult*)> callback;
+    };
+
+    /**
+     * \brief maximum number of batches sent in pipeline mode before their results are processed
+     */
+    static const size_t PIPELINE_DEPTH = 16;
+
+    /**
+     * \brief execute multiple prepared statements whose only parameter is an array of OSM object IDs
+     * for all IDs in batches of up to #ID_ARRAY_BATCH_SIZE IDs
+     *
+     * If all tables share a database connection and pipeline mode is supported by libpq and the
+     * server (PostgreSQL 14 or newer), up to #PIPELINE_DEPTH batches are sent at once without
+     * waiting for the results of the previous ones. This saves a network round trip per batch.
+     * Otherwise, the batches are executed one after another.
+     *
+     * The callbacks are called in the order of the queries and batches after the results of a
+     * pipeline have been received. Therefore, they may send queries themselves.
+     *
+     * \param queries queries to execute
+     *
+     * \throws std::runtime_error if a query fails
+     */
+    static void run_prepared_id_array_statements(std::vector<IdArrayQuery>& queries);
+
 };
 
 
@@ -24,6 +24,8 @@
 #include <hstore_parser.hpp>
 #include <array_parser.hpp>
 #include "bounding_box.hpp"
+#include "content_digest.hpp"
+#include "metatile.hpp"
 #include "osm_vector_tile_impl_definitions.hpp"
 #include "vectortile_generator_config.hpp"
 #include "item_type_conversion.hpp"
@@ -177,8 +179,23 @@ private:
      * You should call the destructor after calling this method (e.g. let this instance go out of scope if it is no pointer).
      *
      * \param path path where to write the file
+     *
+     * \returns false if the file was not written because its content did not change (only if
+     * m_config.m_skip_unchanged is set)
      */
-    void write_file(std::string& path) {
+    bool write_file(std::string& path) {
+        // We have to merge the buffers and sort the objects. Therefore first all nodes are written, then all ways and as last step
+        // all relations.
+        osmium::ObjectPointerCollection objects;
+        sort_buffer(objects);
+        std::string digest;
+        if (m_config.m_skip_unchanged) {
+            digest = content_digest(objects);
+            if (ContentDigest::sidecar(path).matches(digest)) {
+                return false;
+            }
+            ContentDigest::sidecar(path).remove();
+        }
         osmium::io::Header header;
         header.set("generator", "vectortile-generator");
         header.set("copyright", "OpenStreetMap and contributors");
@@ -186,14 +203,38 @@ private:
         header.set("license", "http://opendatacommons.org/licenses/odbl/1-0/");
         osmium::io::File output_file{path};
         osmium::io::overwrite overwrite = osmium::io::overwrite::no;
-        if (m_config.m_force) {
+        if (m_config.m_force || m_config.m_skip_unchanged) {
             overwrite = osmium::io::overwrite::allow;
         }
         osmium::io::Writer writer{output_file, header, overwrite};
-        // We have to merge the buffers and sort the objects. Therefore first all nodes are written, then all ways and as last step
-        // all relations.
-        sort_buffer_and_write_it(writer);
+        auto out = osmium::io::make_output_iterator(writer);
+        // std::copy (i.e. copy without comparing the objects) does not work. Nodes with tags beyond the
+        // bounding box will not be written to the output file.
+        std::unique_copy(objects.cbegin(), objects.cend(), out, osmium::object_equal_type_id());
         writer.close();
+        if (m_config.m_skip_unchanged) {
+            ContentDigest::sidecar(path).store(digest);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Calculate the digest of the objects written to the file.
+     *
+     * \param objects sorted objects, duplicates are skipped like by write_file()
+     */
+    std::string content_digest(const osmium::ObjectPointerCollection& objects) const {
+        ContentDigest digest;
+        const osmium::OSMObject* previous = nullptr;
+        osmium::object_equal_type_id equal;
+        for (const osmium::OSMObject& object : objects) {
+            if (previous && equal(*previous, object)) {
+                continue;
+            }
+            digest.update(object.data(), object.byte_size());
+            previous = &object;
+        }
+        return digest.hex();
     }
 
     /**
@@ -216,6 +257,7 @@ private:
             const char* version, const char* changeset, const char* uid, const char* timestamp,
             const std::string tags, const postgres_drivers::ColumnsVector& additional_columns,
             const std::vector<const char*>& additional_values) {
+        m_relations_got.insert(id);
         {
             osmium::builder::RelationBuilder relation_builder(m_buffer);
             osmium::Relation& relation = static_cast<osmium::Relation&>(relation_builder.object());
@@ -259,6 +301,7 @@ private:
             const std::vector<osm_vector_tile_impl::MemberIdRoleTypePos> members,
             const char* version, const char* changeset, const char* uid, const char* timestamp,
             const std::vector<osm_vector_tile_impl::StringPair>& tags) {
+        m_relations_got.insert(id);
         {
             osmium::builder::RelationBuilder relation_builder(m_buffer);
             osmium::Relation& relation = static_cast<osmium::Relation&>(relation_builder.object());
@@ -477,22 +520,17 @@ private:
     }
 
     /**
-     * \brief sort objects in a buffer and write them to a file
+     * \brief sort objects in the buffer
      *
      * Code is taken and modified from [Osmium -- OpenStreetMap data manipulation command line tool](http://osmcode.org/osmium)
      * which is Copyright (C) 2013-2016  Jochen Topf <jochen@topf.org> and available under the terms of
      * GNU General Public License version 3 or newer.
      *
-     * \param writer writer which should write the objects to a file
+     * \param objects collection where to add the sorted objects
      */
-    void sort_buffer_and_write_it(osmium::io::Writer& writer) {
-        auto out = osmium::io::make_output_iterator(writer);
-        osmium::ObjectPointerCollection objects;
+    void sort_buffer(osmium::ObjectPointerCollection& objects) {
         osmium::apply(m_buffer, objects);
         objects.sort(osmium::object_order_type_id_reverse_version());
-        // std::copy (i.e. copy without comparing the objects) does not work. Nodes with tags beyond the
-        // bounding box will not be written to the output file.
-        std::unique_copy(objects.cbegin(), objects.cend(), out, osmium::object_equal_type_id());
     }
 
 public:
@@ -583,25 +621,82 @@ public:
         m_data_access.set_bbox(bbox);
     }
 
+    /**
+     * \brief Get the data access instance.
+     */
+    const TDataAccess& data_access() const {
+        return m_data_access;
+    }
+
+    /**
+     * \brief Set the metatile whose tiles are built next.
+     *
+     * The data of all tiles of the metatile is fetched by one set of spatial queries when the
+     * first tile is built.
+     *
+     * \param metatile metatile
+     */
+    void set_metatile(const Metatile& metatile) {
+        m_data_access.set_metatile(metatile);
+    }
+
+    /**
+     * \brief Set a callback receiving the latency of spatial queries, see OSMDataTable::set_latency_callback().
+     */
+    void set_latency_callback(OSMDataTable::latency_callback_type callback) {
+        m_data_access.set_latency_callback(callback);
+    }
+
+    /**
+     * \brief Summarize the source data of a tile for change detection.
+     *
+     * \param bbox bounding box of the tile
+     */
+    std::string source_state(const BoundingBox& bbox) {
+        return m_data_access.source_state(bbox);
+    }
+
+    /**
+     * \brief Estimate the number of rows returned by the spatial queries of a tile.
+     *
+     * \param bbox bounding box of the tile
+     */
+    double estimate_rows(const BoundingBox& bbox) {
+        return m_data_access.estimate_rows(bbox);
+    }
+
     /**
      * \brief build the vector tile
      *
      * This method will be called by the class VectorTile to start the work.
      *
      * \param output_path location where to write the tile
+     *
+     * \returns false if the tile was not written because its content did not change
      */
-    void generate_vectortile(std::string& output_path) {
-        m_data_access.get_nodes_inside();
-        m_data_access.get_ways_inside();
-        m_data_access.get_relations_inside();
+    bool generate_vectortile(std::string& output_path) {
+        if (m_config.m_async_queries) {
+            m_data_access.get_objects_inside();
+        } else {
+            m_data_access.get_nodes_inside();
+            m_data_access.get_ways_inside();
+            m_data_access.get_relations_inside();
+        }
         if (m_config.m_recurse_relations) {
-            m_data_access.get_missing_relations(m_missing_relations);
+            // Relations can be referenced by relations which were added before them.
+            for (const osmium::object_id_type id : m_relations_got) {
+                m_missing_relations.erase(id);
+            }
+            if (!m_missing_relations.empty()) {
+                // The data access returns the whole closure of the missing relations at once.
+                m_data_access.get_missing_relations(m_missing_relations);
+            }
         }
         if (m_config.m_recurse_ways) {
             m_data_access.get_missing_ways(m_missing_ways);
         }
         m_data_access.get_missing_nodes(m_missing_nodes);
-        write_file(output_path);
+        return write_file(output_path);
     }
 };
 
@@ -0,0 +1,53 @@
+/*
+ * sidecar_file.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "sidecar_file.hpp"
+
+SidecarFile::SidecarFile(const std::string& tile_path, const char* suffix) :
+    m_tile_path(tile_path),
+    m_path(tile_path + "." + suffix) {
+}
+
+bool SidecarFile::matches(const std::string& value) const {
+    struct stat stat_result;
+    if (stat(m_tile_path.c_str(), &stat_result) != 0) {
+        return false;
+    }
+    std::ifstream file {m_path};
+    std::string stored;
+    return std::getline(file, stored) && stored == value;
+}
+
+bool SidecarFile::read(std::string& value) const {
+    std::ifstream file {m_path};
+    return static_cast<bool>(std::getline(file, value));
+}
+
+void SidecarFile::remove() const {
+    unlink(m_path.c_str());
+}
+
+void SidecarFile::store(const std::string& value) const {
+    // write to a temporary file and rename it to avoid incomplete sidecar files
+    std::string temp = m_path + ".tmp";
+    {
+        std::ofstream file {temp};
+        file << value << '\n';
+        if (!file.flush()) {
+            throw std::runtime_error{(boost::format("Failed to write %1%") % temp).str()};
+        }
+    }
+    if (rename(temp.c_str(), m_path.c_str()) != 0) {
+        throw std::runtime_error{(boost::format("Failed to rename %1% to %2%") % temp % m_path).str()};
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * sidecar_file.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_SIDECAR_FILE_HPP_
+#define SRC_SIDECAR_FILE_HPP_
+
+#include <string>
+
+/**
+ * \brief Small file next to a tile storing a value describing the tile
+ *
+ * The sidecar file of the tile `PATH` is `PATH.SUFFIX`. It contains one line.
+ */
+class SidecarFile {
+    /// path of the tile
+    std::string m_tile_path;
+
+    /// path of the sidecar file
+    std::string m_path;
+
+public:
+    /**
+     * \param tile_path path of the tile
+     * \param suffix suffix of the sidecar file (without leading dot)
+     */
+    SidecarFile(const std::string& tile_path, const char* suffix);
+
+    /**
+     * \brief path of the sidecar file
+     */
+    const std::string& path() const {
+        return m_path;
+    }
+
+    /**
+     * \brief Check if the tile exists and the stored value is equal to the given one.
+     */
+    bool matches(const std::string& value) const;
+
+    /**
+     * \brief Read the stored value.
+     *
+     * \param value stored value (output)
+     *
+     * \returns false if there is no sidecar file
+     */
+    bool read(std::string& value) const;
+
+    /**
+     * \brief Remove the sidecar file.
+     *
+     * This has to be done before a tile is written. Otherwise an incomplete tile could be treated as
+     * unchanged if the program is interrupted while writing it.
+     */
+    void remove() const;
+
+    /**
+     * \brief Store a value.
+     *
+     * \throws std::runtime_error if the sidecar file cannot be written
+     */
+    void store(const std::string& value) const;
+};
+
+#endif /* SRC_SIDECAR_FILE_HPP_ */
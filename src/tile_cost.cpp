@@ -0,0 +1,73 @@
+/*
+ * tile_cost.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "tile_cost.hpp"
+
+CostEstimate tile_cost::parse(const char* name) {
+    if (!strcmp(name, "zoom")) {
+        return CostEstimate::ZOOM;
+    } else if (!strcmp(name, "explain")) {
+        return CostEstimate::EXPLAIN;
+    } else if (!strcmp(name, "previous")) {
+        return CostEstimate::PREVIOUS;
+    }
+    throw std::runtime_error{(boost::format("Unknown cost estimate \"%1%\"") % name).str()};
+}
+
+double tile_cost::zoom_cost(const int zoom, const int max_zoom) {
+    return std::ldexp(1.0, 2 * std::max(max_zoom - zoom, 0));
+}
+
+double tile_cost::plan_rows(const char* plan) {
+    const char* rows = strstr(plan, " rows=");
+    if (rows) {
+        char* end;
+        const double value = strtod(rows + 6, &end);
+        if (end != rows + 6) {
+            return value;
+        }
+    }
+    throw std::runtime_error{(boost::format("No row estimate in query plan \"%1%\"") % plan).str()};
+}
+
+double tile_cost::recorded_rows(const std::string& source_state) {
+    double rows = 0;
+    size_t begin = 0;
+    while (begin < source_state.size()) {
+        size_t end = source_state.find(',', begin);
+        if (end == std::string::npos) {
+            end = source_state.size();
+        }
+        const std::string entry = source_state.substr(begin, end - begin);
+        char* count_end;
+        const double count = strtod(entry.c_str(), &count_end);
+        if (count_end == entry.c_str() || *count_end != '/') {
+            return -1;
+        }
+        rows += count;
+        begin = end + 1;
+    }
+    return begin == 0 ? -1 : rows;
+}
+
+std::vector<size_t> tile_cost::longest_first(const std::vector<double>& costs) {
+    std::vector<size_t> order;
+    order.reserve(costs.size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return costs[a] > costs[b];
+    });
+    return order;
+}
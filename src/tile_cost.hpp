@@ -0,0 +1,86 @@
+/*
+ * tile_cost.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_COST_HPP_
+#define SRC_TILE_COST_HPP_
+
+#include <string>
+#include <vector>
+
+/**
+ * \brief source of the predicted cost of a tile
+ */
+enum class CostEstimate : char {
+    /// tiles are not scheduled by cost
+    NONE = 0,
+    /// area of the tile
+    ZOOM = 1,
+    /// row estimates of the query planner for the spatial queries of the tile
+    EXPLAIN = 2,
+    /// number of rows recorded by the previous run with --precheck=envelope, EXPLAIN for tiles without record
+    PREVIOUS = 3
+};
+
+/**
+ * \brief Functions to predict the cost of creating a tile and to schedule expensive tiles first.
+ *
+ * A few tiles at low zoom levels or in dense areas take much longer than most other tiles. If
+ * they are created last, a single thread works on them while the others are idle.
+ */
+namespace tile_cost {
+
+    /**
+     * \brief Parse the name of a cost estimate given by the user.
+     *
+     * \param name "zoom", "explain" or "previous"
+     *
+     * \throws std::runtime_error if the name is unknown
+     */
+    CostEstimate parse(const char* name);
+
+    /**
+     * \brief Cost of a tile based on its zoom level only.
+     *
+     * \param zoom zoom level of the tile
+     * \param max_zoom highest zoom level of all tiles
+     *
+     * \returns area of the tile in units of a tile at max_zoom
+     */
+    double zoom_cost(const int zoom, const int max_zoom);
+
+    /**
+     * \brief Get the row estimate of the top node of a query plan.
+     *
+     * \param plan first line of the output of EXPLAIN, e.g. `Seq Scan on t  (cost=0.00..1.10 rows=10 width=8)`
+     *
+     * \throws std::runtime_error if the line does not contain a row estimate
+     */
+    double plan_rows(const char* plan);
+
+    /**
+     * \brief Get the number of rows of a tile recorded by --precheck=envelope.
+     *
+     * \param source_state content of the sidecar file, comma-separated `COUNT/TIMESTAMP` entries
+     *
+     * \returns sum of the counts or a negative value if the state cannot be parsed
+     */
+    double recorded_rows(const std::string& source_state);
+
+    /**
+     * \brief Order in which work items are processed if the most expensive ones are processed first.
+     *
+     * Items with equal cost keep their order.
+     *
+     * \param costs cost of each item
+     *
+     * \returns indexes of the items
+     */
+    std::vector<size_t> longest_first(const std::vector<double>& costs);
+
+} // namespace tile_cost
+
+#endif /* SRC_TILE_COST_HPP_ */
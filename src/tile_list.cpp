@@ -0,0 +1,314 @@
+/*
+ * tile_list.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "tile_list.hpp"
+
+const int TileList::MAX_ZOOM;
+const int TileList::MAX_EXPANSION_DEPTH;
+
+namespace {
+
+    /**
+     * \brief Read-only memory mapping of a file which is unmapped on destruction.
+     */
+    class MappedFile {
+        void* m_data = MAP_FAILED;
+        size_t m_size = 0;
+
+    public:
+        MappedFile(const int fd, const size_t size, const std::string& name) :
+            m_size(size) {
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m_data == MAP_FAILED) {
+                throw std::runtime_error{(boost::format("Failed to map %1% into memory: %2%") % name
+                        % strerror(errno)).str()};
+            }
+            madvise(m_data, m_size, MADV_SEQUENTIAL);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            munmap(m_data, m_size);
+        }
+
+        const char* begin() const {
+            return static_cast<const char*>(m_data);
+        }
+
+        const char* end() const {
+            return begin() + m_size;
+        }
+    };
+
+    bool is_gzip(const char* begin, const char* end) {
+        return end - begin >= 2 && static_cast<unsigned char>(begin[0]) == 0x1f
+                && static_cast<unsigned char>(begin[1]) == 0x8b;
+    }
+
+    /**
+     * \brief Decompress a buffer compressed using gzip.
+     */
+    std::string gunzip(const char* begin, const char* end, const std::string& name) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        // 16 + MAX_WBITS: expect a gzip header
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error{(boost::format("Failed to decompress %1%: %2%") % name
+                    % (stream.msg ? stream.msg : "unknown error")).str()};
+        }
+        // zlib takes at most std::numeric_limits<uInt>::max() bytes of input at once.
+        const char* next_input = begin;
+        std::string result;
+        char buffer[65536];
+        int ret = Z_OK;
+        while (ret != Z_STREAM_END) {
+            if (stream.avail_in == 0 && next_input != end) {
+                const size_t length = std::min<size_t>(end - next_input, std::numeric_limits<uInt>::max());
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(next_input));
+                stream.avail_in = static_cast<uInt>(length);
+                next_input += length;
+            }
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+            ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_BUF_ERROR && stream.avail_in == 0 && next_input == end) {
+                inflateEnd(&stream);
+                throw std::runtime_error{(boost::format("Failed to decompress %1%: unexpected end of file")
+                        % name).str()};
+            } else if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                std::string message = stream.msg ? stream.msg : "unknown error";
+                inflateEnd(&stream);
+                throw std::runtime_error{(boost::format("Failed to decompress %1%: %2%") % name % message).str()};
+            }
+            result.append(buffer, sizeof(buffer) - stream.avail_out);
+            // concatenated gzip members (e.g. appended expire lists)
+            if (ret == Z_STREAM_END && (stream.avail_in > 0 || next_input != end)) {
+                inflateReset(&stream);
+                ret = Z_OK;
+            }
+        }
+        inflateEnd(&stream);
+        return result;
+    }
+
+    /**
+     * \brief Parse an unsigned integer and advance the position.
+     *
+     * \returns false if there is no digit at the position or the number is too large
+     */
+    bool parse_number(const char*& pos, const char* end, uint32_t& value) {
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return false;
+        }
+        uint64_t result = 0;
+        while (pos != end && *pos >= '0' && *pos <= '9') {
+            result = result * 10 + (*pos - '0');
+            if (result > 0xffffffff) {
+                return false;
+            }
+            ++pos;
+        }
+        value = static_cast<uint32_t>(result);
+        return true;
+    }
+
+    bool is_space(const char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+} // namespace
+
+void TileList::set_zoom_range(const int min_zoom, const int max_zoom) {
+    if (min_zoom < 0 || max_zoom > MAX_ZOOM || min_zoom > max_zoom) {
+        throw std::runtime_error{(boost::format("Invalid zoom range %1%-%2%") % min_zoom % max_zoom).str()};
+    }
+    m_min_zoom = min_zoom;
+    m_max_zoom = max_zoom;
+}
+
+void TileList::set_collapse_zoom(const int zoom) {
+    if (zoom < 0 || zoom > MAX_ZOOM) {
+        throw std::runtime_error{(boost::format("Invalid zoom level %1%") % zoom).str()};
+    }
+    m_collapse_zoom = zoom;
+}
+
+void TileList::add_unique(const uint32_t x, const uint32_t y, const int zoom) {
+    // 5 bits zoom level, 29 bits per index
+    const uint64_t key = (static_cast<uint64_t>(zoom) << 58) | (static_cast<uint64_t>(x) << 29) | y;
+    if (m_seen.insert(key).second) {
+        m_tiles.push_back(Tile{x, y, zoom});
+    }
+}
+
+void TileList::add(uint32_t x, uint32_t y, int zoom) {
+    ++m_tiles_read;
+    if (m_collapse_zoom >= 0 && zoom > m_collapse_zoom) {
+        x >>= zoom - m_collapse_zoom;
+        y >>= zoom - m_collapse_zoom;
+        zoom = m_collapse_zoom;
+    }
+    if (m_min_zoom < 0) {
+        add_unique(x, y, zoom);
+        return;
+    }
+    if (m_max_zoom - zoom > MAX_EXPANSION_DEPTH) {
+        throw std::runtime_error{(boost::format("Tile %1%/%2%/%3% cannot be expanded to zoom level %4%, the"
+                " zoom range may exceed the zoom level of a tile by %5% levels at most") % zoom % x % y
+                % m_max_zoom % MAX_EXPANSION_DEPTH).str()};
+    }
+    for (int z = m_min_zoom; z <= m_max_zoom; ++z) {
+        if (z <= zoom) {
+            add_unique(x >> (zoom - z), y >> (zoom - z), z);
+        } else {
+            const int shift = z - zoom;
+            const uint32_t count = 1u << shift;
+            for (uint32_t dx = 0; dx < count; ++dx) {
+                for (uint32_t dy = 0; dy < count; ++dy) {
+                    add_unique((x << shift) + dx, (y << shift) + dy, z);
+                }
+            }
+        }
+    }
+}
+
+void TileList::parse(const char* begin, const char* end, const std::string& name) {
+    const char* pos = begin;
+    size_t line = 0;
+    while (pos != end) {
+        ++line;
+        while (pos != end && is_space(*pos)) {
+            ++pos;
+        }
+        if (pos == end) {
+            break;
+        } else if (*pos == '\n') {
+            ++pos;
+            continue;
+        }
+        uint32_t zoom;
+        uint32_t x;
+        uint32_t y;
+        bool ok = parse_number(pos, end, zoom) && pos != end && *pos++ == '/'
+                && parse_number(pos, end, x) && pos != end && *pos++ == '/'
+                && parse_number(pos, end, y);
+        while (ok && pos != end && is_space(*pos)) {
+            ++pos;
+        }
+        ok = ok && (pos == end || *pos == '\n');
+        if (!ok) {
+            throw std::runtime_error{(boost::format("%1%, line %2%: expected zoom/x/y") % name % line).str()};
+        }
+        if (zoom > static_cast<uint32_t>(MAX_ZOOM) || (x >> zoom) > 0 || (y >> zoom) > 0) {
+            throw std::runtime_error{(boost::format("%1%, line %2%: invalid tile %3%/%4%/%5%") % name % line
+                    % zoom % x % y).str()};
+        }
+        add(x, y, static_cast<int>(zoom));
+        if (pos != end) {
+            ++pos;
+        }
+    }
+}
+
+void TileList::read_file(const int fd, const std::string& name) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            return;
+        }
+        MappedFile file {fd, static_cast<size_t>(st.st_size), name};
+        if (is_gzip(file.begin(), file.end())) {
+            std::string buffer = gunzip(file.begin(), file.end(), name);
+            parse(buffer.data(), buffer.data() + buffer.size(), name);
+        } else {
+            parse(file.begin(), file.end(), name);
+        }
+        return;
+    }
+    // pipes and other files which cannot be mapped
+    std::string buffer;
+    char chunk[65536];
+    ssize_t count;
+    while ((count = ::read(fd, chunk, sizeof(chunk))) != 0) {
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error{(boost::format("Failed to read %1%: %2%") % name % strerror(errno)).str()};
+        }
+        buffer.append(chunk, count);
+    }
+    if (is_gzip(buffer.data(), buffer.data() + buffer.size())) {
+        buffer = gunzip(buffer.data(), buffer.data() + buffer.size(), name);
+    }
+    parse(buffer.data(), buffer.data() + buffer.size(), name);
+}
+
+void TileList::read(const char* filename) {
+    if (!strcmp(filename, "-")) {
+        read_file(STDIN_FILENO, "standard input");
+        return;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error{(boost::format("Failed to open %1%: %2%") % filename % strerror(errno)).str()};
+    }
+    try {
+        read_file(fd, filename);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+void TileList::clear() {
+    m_tiles.clear();
+    m_seen.clear();
+    m_tiles_read = 0;
+}
+
+std::vector<BoundingBox> TileList::bboxes() const {
+    std::vector<BoundingBox> result;
+    result.reserve(m_tiles.size());
+    for (const Tile& tile : m_tiles) {
+        result.emplace_back(static_cast<int>(tile.x), static_cast<int>(tile.y), tile.zoom);
+    }
+    return result;
+}
+
+/*static*/ void TileList::parse_zoom_range(const char* range, int& min_zoom, int& max_zoom) {
+    const char* pos = range;
+    const char* end = range + strlen(range);
+    uint32_t min;
+    uint32_t max;
+    if (!parse_number(pos, end, min)) {
+        throw std::runtime_error{(boost::format("Invalid zoom range \"%1%\"") % range).str()};
+    }
+    max = min;
+    if (pos != end && (*pos++ != '-' || !parse_number(pos, end, max))) {
+        throw std::runtime_error{(boost::format("Invalid zoom range \"%1%\"") % range).str()};
+    }
+    if (pos != end || max > static_cast<uint32_t>(MAX_ZOOM)) {
+        throw std::runtime_error{(boost::format("Invalid zoom range \"%1%\"") % range).str()};
+    }
+    min_zoom = static_cast<int>(min);
+    max_zoom = static_cast<int>(max);
+}
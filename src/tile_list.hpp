@@ -0,0 +1,160 @@
+/*
+ * tile_list.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_LIST_HPP_
+#define SRC_TILE_LIST_HPP_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "bounding_box.hpp"
+
+/**
+ * \brief List of tiles to be created in batch mode.
+ *
+ * The list is read from a file of lines in the format `zoom/x/y` (expire list of osm2pgsql or
+ * Cerepso). The file can be compressed using gzip. Each tile is added once only, duplicates are
+ * dropped.
+ *
+ * Tiles can be expanded to a range of zoom levels (their ancestors and descendants at these
+ * zoom levels are added instead of them) or collapsed to a zoom level (tiles of higher zoom levels
+ * are replaced by their ancestor at that zoom level).
+ */
+class TileList {
+    /// x index, y index and zoom level of a tile
+    struct Tile {
+        uint32_t x;
+        uint32_t y;
+        int zoom;
+    };
+
+    /// tiles in order of their first occurence in the input
+    std::vector<Tile> m_tiles;
+
+    /// keys of all tiles in m_tiles
+    std::unordered_set<uint64_t> m_seen;
+
+    /// lowest zoom level to expand tiles to, -1 if tiles are not expanded
+    int m_min_zoom = -1;
+
+    /// highest zoom level to expand tiles to
+    int m_max_zoom = -1;
+
+    /// zoom level to collapse tiles to, -1 if tiles are not collapsed
+    int m_collapse_zoom = -1;
+
+    /// number of tiles read from the input
+    size_t m_tiles_read = 0;
+
+    /**
+     * \brief Add a tile unless it has been added before.
+     */
+    void add_unique(const uint32_t x, const uint32_t y, const int zoom);
+
+    /**
+     * \brief Add a tile read from the input after expanding or collapsing it.
+     *
+     * \throws std::runtime_error if the tile would be expanded by more than #MAX_EXPANSION_DEPTH zoom levels
+     */
+    void add(uint32_t x, uint32_t y, int zoom);
+
+    /**
+     * \brief Read a file into memory and decompress it if it is compressed using gzip.
+     *
+     * Uncompressed files are mapped into memory and parsed without copying them.
+     */
+    void read_file(const int fd, const std::string& name);
+
+public:
+    /// highest supported zoom level
+    static const int MAX_ZOOM = 29;
+
+    /// maximum number of zoom levels a tile is expanded to its descendants (4^8 = 65536 tiles)
+    static const int MAX_EXPANSION_DEPTH = 8;
+
+    TileList() = default;
+
+    /**
+     * \brief Expand each tile to its ancestors and descendants in a range of zoom levels.
+     *
+     * The tile itself is kept if its zoom level is within the range. Reading a tile more than
+     * #MAX_EXPANSION_DEPTH zoom levels lower than the upper end of the range fails.
+     *
+     * \param min_zoom lowest zoom level
+     * \param max_zoom highest zoom level
+     *
+     * \throws std::runtime_error if the range is invalid
+     */
+    void set_zoom_range(const int min_zoom, const int max_zoom);
+
+    /**
+     * \brief Replace tiles of zoom levels higher than the given one by their ancestor at that zoom level.
+     *
+     * \throws std::runtime_error if the zoom level is invalid
+     */
+    void set_collapse_zoom(const int zoom);
+
+    /**
+     * \brief Read tiles from a file.
+     *
+     * \param filename name of the file, "-" reads from standard input
+     *
+     * \throws std::runtime_error if the file cannot be read or contains invalid lines
+     */
+    void read(const char* filename);
+
+    /**
+     * \brief Parse tiles from a buffer.
+     *
+     * \param begin begin of the buffer
+     * \param end end of the buffer
+     * \param name name of the input used in error messages
+     *
+     * \throws std::runtime_error if the buffer contains invalid lines
+     */
+    void parse(const char* begin, const char* end, const std::string& name = "tile list");
+
+    /**
+     * \brief Remove all tiles from the list.
+     *
+     * The zoom range and the collapse zoom level are kept.
+     */
+    void clear();
+
+    /**
+     * \brief number of tiles read from the input (including duplicates)
+     */
+    size_t tiles_read() const {
+        return m_tiles_read;
+    }
+
+    /**
+     * \brief number of unique tiles in the list
+     */
+    size_t size() const {
+        return m_tiles.size();
+    }
+
+    /**
+     * \brief Build the bounding boxes of all tiles in the list.
+     */
+    std::vector<BoundingBox> bboxes() const;
+
+    /**
+     * \brief Parse a zoom range given by the user.
+     *
+     * \param range "MIN-MAX" or a single zoom level
+     * \param min_zoom lowest zoom level (output)
+     * \param max_zoom highest zoom level (output)
+     *
+     * \throws std::runtime_error if the range cannot be parsed
+     */
+    static void parse_zoom_range(const char* range, int& min_zoom, int& max_zoom);
+};
+
+#endif /* SRC_TILE_LIST_HPP_ */
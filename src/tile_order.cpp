@@ -0,0 +1,83 @@
+/*
+ * tile_order.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <boost/format.hpp>
+#include "bounding_box.hpp"
+#include "jobs_database.hpp"
+#include "tile_order.hpp"
+
+TileOrder tile_order::parse(const char* name) {
+    if (!strcmp(name, "none")) {
+        return TileOrder::NONE;
+    } else if (!strcmp(name, "quadtree")) {
+        return TileOrder::QUADTREE;
+    } else if (!strcmp(name, "hilbert")) {
+        return TileOrder::HILBERT;
+    }
+    throw std::runtime_error{(boost::format("Unknown tile order \"%1%\"") % name).str()};
+}
+
+uint64_t tile_order::hilbert_index(uint32_t x, uint32_t y, const int zoom) {
+    uint64_t index = 0;
+    for (uint32_t s = (uint32_t(1) << zoom) >> 1; s > 0; s >>= 1) {
+        const uint32_t rx = (x & s) ? 1 : 0;
+        const uint32_t ry = (y & s) ? 1 : 0;
+        index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+        // rotate the quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+void tile_order::sort(std::vector<BoundingBox>& tiles, const TileOrder order) {
+    if (order == TileOrder::NONE || tiles.empty()) {
+        return;
+    }
+    int max_zoom = 0;
+    for (const BoundingBox& tile : tiles) {
+        max_zoom = std::max(max_zoom, tile.m_zoom);
+    }
+    // The tiles of higher zoom levels inside a tile occupy a contiguous range of the curve at the
+    // highest zoom level. The range starts at the position of the tile multiplied by the number of
+    // tiles it contains.
+    auto key = [&](const BoundingBox& tile) {
+        const int shift = 2 * (max_zoom - tile.m_zoom);
+        if (order == TileOrder::HILBERT) {
+            return hilbert_index(tile.m_x, tile.m_y, tile.m_zoom) << shift;
+        }
+        return static_cast<uint64_t>(JobsDatabase::xy_to_quadtree(tile.m_x, tile.m_y, tile.m_zoom)) << shift;
+    };
+    std::vector<std::pair<uint64_t, size_t>> keys;
+    keys.reserve(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        keys.emplace_back(key(tiles[i]), i);
+    }
+    // Ties (a tile and the first tiles of higher zoom levels inside it) are sorted by zoom level.
+    std::stable_sort(keys.begin(), keys.end(), [&](const std::pair<uint64_t, size_t>& a,
+            const std::pair<uint64_t, size_t>& b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return tiles[a.second].m_zoom < tiles[b.second].m_zoom;
+    });
+    std::vector<BoundingBox> sorted;
+    sorted.reserve(tiles.size());
+    for (const std::pair<uint64_t, size_t>& k : keys) {
+        sorted.push_back(tiles[k.second]);
+    }
+    tiles.swap(sorted);
+}
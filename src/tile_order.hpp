@@ -0,0 +1,69 @@
+/*
+ * tile_order.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_ORDER_HPP_
+#define SRC_TILE_ORDER_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+class BoundingBox;
+
+/**
+ * \brief order in which the tiles of a batch are processed
+ */
+enum class TileOrder : char {
+    /// order of the tiles list
+    NONE = 0,
+    /// Z-order curve (quadtree IDs)
+    QUADTREE = 1,
+    /// Hilbert curve
+    HILBERT = 2
+};
+
+/**
+ * \brief Functions to sort tiles along a space-filling curve.
+ *
+ * Neighbouring tiles are processed one after another if they are sorted along a space-filling curve.
+ * They share most database pages and objects.
+ */
+namespace tile_order {
+
+    /**
+     * \brief Parse the name of a tile order given by the user.
+     *
+     * \param name "none", "quadtree" or "hilbert"
+     *
+     * \throws std::runtime_error if the name is unknown
+     */
+    TileOrder parse(const char* name);
+
+    /**
+     * \brief Calculate the position of a tile on the Hilbert curve.
+     *
+     * \param x x index
+     * \param y y index
+     * \param zoom zoom level, at most 31
+     *
+     * \returns distance from the start of the curve
+     */
+    uint64_t hilbert_index(uint32_t x, uint32_t y, const int zoom);
+
+    /**
+     * \brief Sort tiles along a space-filling curve.
+     *
+     * Tiles of different zoom levels are compared at the highest zoom level of the list. A tile
+     * is sorted before the tiles of higher zoom levels it contains. The sort is stable.
+     *
+     * \param tiles tiles to sort
+     * \param order order
+     */
+    void sort(std::vector<BoundingBox>& tiles, const TileOrder order);
+
+} // namespace tile_order
+
+#endif /* SRC_TILE_ORDER_HPP_ */
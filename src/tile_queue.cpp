@@ -0,0 +1,137 @@
+/*
+ * tile_queue.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "connection_manager.hpp"
+#include "tile_queue.hpp"
+
+constexpr size_t TileQueue::MAX_STATEMENT_TILES;
+
+TileQueue::TileQueue(const std::string& database_name) {
+    std::string connection_params = ConnectionManager::conninfo(database_name);
+    m_database_connection = PQconnectdb(connection_params.c_str());
+    if (PQstatus(m_database_connection) != CONNECTION_OK) {
+        std::string message = PQerrorMessage(m_database_connection);
+        PQfinish(m_database_connection);
+        throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n")
+            % message).str());
+    }
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0) {
+        host[0] = '\0';
+    }
+    host[sizeof(host) - 1] = '\0';
+    m_worker = worker_name(host, static_cast<long>(getpid()));
+
+    // Tiles of the list which are in the queue already are marked as expired again if they are claimed.
+    std::string tiles = "SELECT DISTINCT * FROM unnest($1::integer[], $2::integer[], $3::integer[])";
+    std::string query = "INSERT INTO tile_queue (zoom, x, y) " + tiles + " ON CONFLICT (zoom, x, y)" \
+            " DO UPDATE SET expired_again = true WHERE tile_queue.leased_until IS NOT NULL";
+    create_prepared_statement("enqueue", query, 3);
+    query = "UPDATE tile_queue AS q SET leased_until = now() + $2::integer * interval '1 second', worker = $3," \
+            " expired_again = false" \
+            " FROM (SELECT zoom, x, y FROM tile_queue WHERE leased_until IS NULL OR leased_until < now()" \
+            " LIMIT $1::integer FOR UPDATE SKIP LOCKED) AS c" \
+            " WHERE q.zoom = c.zoom AND q.x = c.x AND q.y = c.y RETURNING q.zoom, q.x, q.y";
+    create_prepared_statement("claim", query, 3);
+    // Rows which are enqueued again while they are deleted are skipped by the DELETE statement
+    // and released by the UPDATE statement.
+    query = "DELETE FROM tile_queue WHERE (zoom, x, y) IN (" + tiles + ") AND worker = $4 AND NOT expired_again";
+    create_prepared_statement("complete", query, 4);
+    query = "UPDATE tile_queue SET leased_until = NULL, worker = NULL WHERE (zoom, x, y) IN (" + tiles + ")" \
+            " AND worker = $4";
+    create_prepared_statement("release", query, 4);
+}
+
+TileQueue::~TileQueue() {
+    PQfinish(m_database_connection);
+}
+
+/*static*/ std::string TileQueue::worker_name(const char* host, const long pid) {
+    return (boost::format("%1%:%2%") % host % pid).str();
+}
+
+void TileQueue::create_prepared_statement(const char* name, const std::string& query, int params_count) {
+    PGresult *result = PQprepare(m_database_connection, name, query.c_str(), params_count, NULL);
+    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+        PQclear(result);
+        throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % PQerrorMessage(m_database_connection)).str());
+    }
+    PQclear(result);
+}
+
+size_t TileQueue::run_tiles_statement(const char* name, const std::vector<BoundingBox>& tiles, const bool with_worker) {
+    size_t affected = 0;
+    for (size_t begin = 0; begin < tiles.size(); begin += MAX_STATEMENT_TILES) {
+        const size_t end = std::min(tiles.size(), begin + MAX_STATEMENT_TILES);
+        std::string arrays[3];
+        for (std::string& array : arrays) {
+            array = "{";
+        }
+        for (size_t i = begin; i < end; ++i) {
+            const int values[3] = {tiles[i].m_zoom, tiles[i].m_x, tiles[i].m_y};
+            for (int a = 0; a < 3; ++a) {
+                if (i > begin) {
+                    arrays[a].push_back(',');
+                }
+                arrays[a] += std::to_string(values[a]);
+            }
+        }
+        for (std::string& array : arrays) {
+            array.push_back('}');
+        }
+        const char* const param_values[4] = {arrays[0].c_str(), arrays[1].c_str(), arrays[2].c_str(), m_worker.c_str()};
+        PGresult *result = PQexecPrepared(m_database_connection, name, with_worker ? 4 : 3, param_values, nullptr,
+                nullptr, 0);
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+            std::string message = PQresultErrorMessage(result);
+            PQclear(result);
+            throw std::runtime_error((boost::format("Statement %1% on the tile queue failed: %2%\n") % name
+                    % message).str());
+        }
+        affected += static_cast<size_t>(atol(PQcmdTuples(result)));
+        PQclear(result);
+    }
+    return affected;
+}
+
+size_t TileQueue::enqueue(const std::vector<BoundingBox>& tiles) {
+    return run_tiles_statement("enqueue", tiles, false);
+}
+
+std::vector<BoundingBox> TileQueue::claim(const int max_tiles, const int lease_seconds) {
+    const std::string limit = std::to_string(max_tiles);
+    const std::string lease = std::to_string(lease_seconds);
+    const char* const param_values[3] = {limit.c_str(), lease.c_str(), m_worker.c_str()};
+    PGresult *result = PQexecPrepared(m_database_connection, "claim", 3, param_values, nullptr, nullptr, 0);
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        std::string message = PQresultErrorMessage(result);
+        PQclear(result);
+        throw std::runtime_error((boost::format("Claiming tiles from the tile queue failed: %1%\n") % message).str());
+    }
+    std::vector<BoundingBox> tiles;
+    tiles.reserve(PQntuples(result));
+    for (int i = 0; i < PQntuples(result); ++i) {
+        tiles.emplace_back(atoi(PQgetvalue(result, i, 1)), atoi(PQgetvalue(result, i, 2)),
+                atoi(PQgetvalue(result, i, 0)));
+    }
+    PQclear(result);
+    return tiles;
+}
+
+void TileQueue::complete(const std::vector<BoundingBox>& tiles) {
+    run_tiles_statement("complete", tiles, true);
+    run_tiles_statement("release", tiles, true);
+}
+
+void TileQueue::release(const std::vector<BoundingBox>& tiles) {
+    run_tiles_statement("release", tiles, true);
+}
@@ -0,0 +1,145 @@
+/*
+ * tile_queue.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_QUEUE_HPP_
+#define SRC_TILE_QUEUE_HPP_
+
+#include <libpq-fe.h>
+#include <string>
+#include <vector>
+#include "bounding_box.hpp"
+
+/**
+ * \brief Queue of tiles to create shared by multiple processes
+ *
+ * The queue is a table in the jobs database (see JobsDatabase). Any number of processes on any
+ * number of hosts can enqueue tiles and claim batches of tiles. A batch is claimed for a limited
+ * time (lease) using `SELECT … FOR UPDATE SKIP LOCKED`, processes claiming at the same time get
+ * different tiles without waiting for each other. Tiles of a process which crashed are claimed
+ * by another process after their lease expired.
+ *
+ * If a claimed tile is enqueued again, it is marked as expired again and put back into the queue
+ * after it has been completed because the data used to create it may be outdated.
+ *
+ * The table has to be created before:
+ * ```CREATE TABLE tile_queue (zoom integer, x integer, y integer, leased_until timestamptz, worker text,
+ *     expired_again boolean NOT NULL DEFAULT false, PRIMARY KEY (zoom, x, y));```
+ */
+class TileQueue {
+    /// connection to database
+    PGconn* m_database_connection;
+
+    /// name of this process in the queue (host name and process ID)
+    std::string m_worker;
+
+    /// maximum number of tiles per statement
+    static constexpr size_t MAX_STATEMENT_TILES = 10000;
+
+    /**
+     * \brief create a prepared statement
+     *
+     * \param name name of the statement
+     * \param query query template
+     * \param params_count number of parameters
+     */
+    void create_prepared_statement(const char* name, const std::string& query, int params_count);
+
+    /**
+     * \brief Execute a prepared statement whose first three parameters are the arrays of zoom levels,
+     * x and y indexes of tiles.
+     *
+     * Large lists are split into multiple statements.
+     *
+     * \param name name of the statement
+     * \param tiles tiles
+     * \param with_worker pass the name of this process as fourth parameter
+     *
+     * \returns number of rows affected
+     *
+     * \throws std::runtime_error if the statement fails
+     */
+    size_t run_tiles_statement(const char* name, const std::vector<BoundingBox>& tiles, const bool with_worker);
+
+public:
+    /**
+     * \param database_name name of the database or libpq connection string
+     *
+     * \throws std::runtime_error if the connection fails
+     */
+    explicit TileQueue(const std::string& database_name);
+
+    TileQueue(const TileQueue&) = delete;
+    TileQueue& operator=(const TileQueue&) = delete;
+
+    /**
+     * close connection to database
+     */
+    ~TileQueue();
+
+    /**
+     * \brief Build the name of a process in the queue.
+     *
+     * \param host host name
+     * \param pid process ID
+     */
+    static std::string worker_name(const char* host, const long pid);
+
+    /**
+     * \brief name of this process in the queue
+     */
+    const std::string& worker() const {
+        return m_worker;
+    }
+
+    /**
+     * \brief Add tiles to the queue.
+     *
+     * Tiles which are in the queue already are not added again.
+     *
+     * \param tiles tiles
+     *
+     * \returns number of tiles added or marked as expired again
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    size_t enqueue(const std::vector<BoundingBox>& tiles);
+
+    /**
+     * \brief Claim tiles which are neither claimed by another process nor completed.
+     *
+     * \param max_tiles maximum number of tiles
+     * \param lease_seconds duration of the claim
+     *
+     * \returns claimed tiles, empty if there are no unclaimed tiles
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    std::vector<BoundingBox> claim(const int max_tiles, const int lease_seconds);
+
+    /**
+     * \brief Remove completed tiles from the queue.
+     *
+     * Tiles which have been enqueued again since they were claimed are released instead. Tiles
+     * whose lease was taken over by another process are not changed.
+     *
+     * \param tiles tiles claimed by this process
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void complete(const std::vector<BoundingBox>& tiles);
+
+    /**
+     * \brief Release the claim of tiles which have not been completed.
+     *
+     * \param tiles tiles claimed by this process
+     *
+     * \throws std::runtime_error if the query fails
+     */
+    void release(const std::vector<BoundingBox>& tiles);
+};
+
+#endif /* SRC_TILE_QUEUE_HPP_ */
@@ -0,0 +1,266 @@
+/*
+ * tile_server.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_SERVER_HPP_
+#define SRC_TILE_SERVER_HPP_
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/format.hpp>
+#include "bounding_box.hpp"
+#include "http_server.hpp"
+#include "input/column_config_parser.hpp"
+#include "jobs_database.hpp"
+#include "lru_cache.hpp"
+#include "osmvectortileimpl.hpp"
+#include "vector_tile.hpp"
+#include "vectortile_generator_config.hpp"
+
+/**
+ * \brief Long-running server creating tiles on request.
+ *
+ * Clients request tiles using HTTP over a Unix domain socket or a local TCP socket. Each worker
+ * thread keeps its database connections and prepared statements open and accepts connections
+ * from the shared listening socket. The response contains the bytes of the tile. If an output
+ * directory is configured, the tiles are written there like in batch mode (and the jobs
+ * database is updated), otherwise they are written to a temporary directory and removed after
+ * they have been sent.
+ *
+ * Recently created tiles can be kept in memory and are served without querying the database
+ * again until they reach their maximum age.
+ *
+ * \tparam TDataAccess data access implementation
+ */
+template <typename TDataAccess>
+class TileServer {
+    /// tile key of the cache: 5 bits zoom level, 29 bits per index
+    using tile_key_type = uint64_t;
+
+    /// reference to the program configuration
+    VectortileGeneratorConfig& m_config;
+
+    /// parser of the style file, shared by all workers
+    input::ColumnConfigParser& m_column_parser;
+
+    /// listening socket
+    int m_socket;
+
+    /// tile in the cache
+    struct CachedTile {
+        std::string data;
+        std::chrono::steady_clock::time_point created;
+    };
+
+    /// recently created tiles
+    LruCache<tile_key_type, CachedTile> m_cache;
+
+    /// protects m_cache
+    std::mutex m_cache_mutex;
+
+    /// serializes messages written to the standard output and error
+    std::mutex m_output_mutex;
+
+    static tile_key_type tile_key(const http_server::Request& request) {
+        return (static_cast<uint64_t>(request.zoom) << 58) | (static_cast<uint64_t>(request.x) << 29)
+                | static_cast<uint64_t>(request.y);
+    }
+
+    bool find_cached(const tile_key_type key, std::string& tile) {
+        if (m_config.m_tile_cache_size == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock {m_cache_mutex};
+        CachedTile* cached = m_cache.find(key);
+        if (!cached) {
+            return false;
+        }
+        if (m_config.m_tile_cache_ttl > 0
+                && std::chrono::steady_clock::now() - cached->created > std::chrono::seconds(m_config.m_tile_cache_ttl)) {
+            m_cache.erase(key);
+            return false;
+        }
+        tile = cached->data;
+        return true;
+    }
+
+    void cache(const tile_key_type key, const std::string& tile) {
+        if (m_config.m_tile_cache_size == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock {m_cache_mutex};
+        CachedTile cached {tile, std::chrono::steady_clock::now()};
+        m_cache.insert(key, std::move(cached), tile.size());
+    }
+
+    /**
+     * \brief Temporary directory of a worker which is removed with its contents on destruction.
+     */
+    class TemporaryDirectory {
+        std::string m_path;
+
+    public:
+        TemporaryDirectory() = default;
+
+        TemporaryDirectory(const TemporaryDirectory&) = delete;
+        TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+        ~TemporaryDirectory() {
+            if (!m_path.empty()) {
+                http_server::remove_directory(m_path);
+            }
+        }
+
+        const std::string& create() {
+            m_path = http_server::make_temp_directory();
+            return m_path;
+        }
+    };
+
+    /**
+     * \brief Accept connections and create the requested tiles until an error occurs.
+     */
+    void work() {
+        // Each worker writes the tiles to its own directory unless an output directory is configured.
+        VectortileGeneratorConfig config = m_config;
+        const bool temporary = config.m_output_path.empty();
+        TemporaryDirectory temporary_directory;
+        if (temporary) {
+            config.m_output_path = temporary_directory.create();
+            // tiles are removed after they have been sent
+            config.m_skip_unchanged = false;
+            config.m_precheck = false;
+        }
+        std::unique_ptr<JobsDatabase> jobs_db;
+        if (!temporary && config.m_jobs_database != "") {
+            jobs_db = std::unique_ptr<JobsDatabase>(new JobsDatabase(config.m_jobs_database, config.m_jobs_delay));
+        }
+        TDataAccess data_access {config, m_column_parser};
+        OSMVectorTileImpl<TDataAccess> vector_tile_impl {config, std::move(data_access)};
+
+        while (true) {
+            int client = accept(m_socket, nullptr, nullptr);
+            if (client == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                throw std::runtime_error{(boost::format("accept() failed: %1%") % strerror(errno)).str()};
+            }
+            std::string header;
+            if (!http_server::read_request(client, header)) {
+                close(client);
+                continue;
+            }
+            http_server::Request request = http_server::parse_request(header, config.m_file_suffix);
+            if (request.status != 200) {
+                http_server::send_response(client, request.status, "text/plain", "Invalid request\n");
+                continue;
+            }
+            const tile_key_type key = tile_key(request);
+            std::string tile;
+            if (find_cached(key, tile)) {
+                http_server::send_response(client, 200, http_server::content_type(config.m_file_suffix), tile);
+                continue;
+            }
+            if (config.m_verbose) {
+                std::lock_guard<std::mutex> lock {m_output_mutex};
+                std::cout << "Creating tile " << request.zoom << '/' << request.x << '/' << request.y << '\n';
+            }
+            try {
+                BoundingBox bbox {request.x, request.y, request.zoom};
+                VectorTile<OSMVectorTileImpl<TDataAccess>> vector_tile(config, vector_tile_impl, bbox, jobs_db.get());
+                std::string path = vector_tile.generate_vectortile();
+                tile = http_server::read_file(path);
+                if (temporary) {
+                    unlink(path.c_str());
+                }
+            } catch (std::exception& e) {
+                {
+                    std::lock_guard<std::mutex> lock {m_output_mutex};
+                    std::cerr << "ERROR: Failed to create tile " << request.zoom << '/' << request.x << '/'
+                            << request.y << ": " << e.what() << '\n';
+                }
+                http_server::send_response(client, 500, "text/plain", "Failed to create tile\n");
+                continue;
+            }
+            cache(key, tile);
+            http_server::send_response(client, 200, http_server::content_type(config.m_file_suffix), tile);
+        }
+    }
+
+public:
+    /**
+     * \param config program configuration, an empty output path means that tiles are only sent to the clients
+     * \param column_parser parser of the style file
+     *
+     * \throws std::runtime_error if the socket cannot be opened
+     */
+    TileServer(VectortileGeneratorConfig& config, input::ColumnConfigParser& column_parser) :
+        m_config(config),
+        m_column_parser(column_parser),
+        m_socket(http_server::listen(config.m_serve_address)),
+        m_cache(config.m_tile_cache_size),
+        m_cache_mutex(),
+        m_output_mutex() {
+    }
+
+    TileServer(const TileServer&) = delete;
+    TileServer& operator=(const TileServer&) = delete;
+
+    ~TileServer() {
+        close(m_socket);
+    }
+
+    /**
+     * \brief Serve requests using the configured number of worker threads.
+     *
+     * This method only returns if a worker fails.
+     *
+     * \throws std::runtime_error if a worker fails
+     */
+    void run() {
+        if (m_config.m_threads <= 1) {
+            work();
+            return;
+        }
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < m_config.m_threads; ++t) {
+            threads.emplace_back([&]() {
+                try {
+                    work();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock {error_mutex};
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    // let the other workers leave accept()
+                    shutdown(m_socket, SHUT_RDWR);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif /* SRC_TILE_SERVER_HPP_ */
@@ -0,0 +1,137 @@
+/*
+ * tile_worker.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_TILE_WORKER_HPP_
+#define SRC_TILE_WORKER_HPP_
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include "bounding_box.hpp"
+#include "concurrency_controller.hpp"
+#include "input/column_config_parser.hpp"
+#include "jobs_database.hpp"
+#include "metatile.hpp"
+#include "osmvectortileimpl.hpp"
+#include "sidecar_file.hpp"
+#include "tile_cost.hpp"
+#include "vector_tile.hpp"
+#include "vectortile_generator_config.hpp"
+#include "worker_pool.hpp"
+
+/**
+ * \brief Worker creating tiles of a list
+ *
+ * Each worker owns its data access instance, its vector tile implementation and its connection to
+ * the jobs database. Workers can be kept to create multiple lists of tiles without connecting to
+ * the database again.
+ *
+ * \tparam TDataAccess data access implementation
+ */
+template <typename TDataAccess>
+class TileWorker {
+    /// reference to the program configuration
+    VectortileGeneratorConfig& m_config;
+
+    /// serializes messages written to the standard output
+    std::mutex& m_output_mutex;
+
+    /// connection to the jobs database, empty if no jobs are written
+    std::unique_ptr<JobsDatabase> m_jobs_db;
+
+    OSMVectorTileImpl<TDataAccess> m_vector_tile_impl;
+
+public:
+    /**
+     * \param config program configuration
+     * \param column_parser parser of the style file
+     * \param output_mutex mutex serializing messages written to the standard output
+     * \param controller controller receiving the latency of the spatial queries, may be nullptr
+     */
+    TileWorker(VectortileGeneratorConfig& config, input::ColumnConfigParser& column_parser, std::mutex& output_mutex,
+            ConcurrencyController* controller) :
+        m_config(config),
+        m_output_mutex(output_mutex),
+        m_jobs_db(),
+        m_vector_tile_impl(config, TDataAccess{config, column_parser}) {
+        // initialize connection to jobs' database
+        if (config.m_jobs_database != "") {
+            m_jobs_db = std::unique_ptr<JobsDatabase>(new JobsDatabase(config.m_jobs_database,
+                    config.m_jobs_delay));
+        }
+        if (controller) {
+            m_vector_tile_impl.set_latency_callback([controller](std::chrono::steady_clock::duration latency) {
+                controller->record(latency);
+            });
+        }
+    }
+
+    TileWorker(const TileWorker&) = delete;
+    TileWorker& operator=(const TileWorker&) = delete;
+
+    /**
+     * \brief Create a tile.
+     */
+    void create_tile(BoundingBox bbox) {
+        if (m_config.m_verbose) {
+            std::lock_guard<std::mutex> lock {m_output_mutex};
+            std::cout << "Creating tile " << bbox.m_zoom << '/' << bbox.m_x << '/' << bbox.m_y << '\n';
+        }
+        VectorTile<OSMVectorTileImpl<TDataAccess>> vector_tile(m_config, m_vector_tile_impl, bbox, m_jobs_db.get());
+        vector_tile.generate_vectortile();
+    }
+
+    /**
+     * \brief Create all tiles of a metatile using one set of spatial queries.
+     */
+    void create_metatile(const Metatile& metatile) {
+        m_vector_tile_impl.set_metatile(metatile);
+        for (const BoundingBox& bbox : metatile.tiles()) {
+            create_tile(bbox);
+        }
+    }
+
+    /**
+     * \brief Predict the cost of creating a tile using the cost estimate of the configuration.
+     *
+     * \param bbox tile
+     *
+     * \returns number of rows expected to be returned by the spatial queries of the tile
+     */
+    double estimate_cost(const BoundingBox& bbox) {
+        if (m_config.m_cost_estimate == CostEstimate::PREVIOUS) {
+            std::string source_state;
+            SidecarFile source_sidecar {VectorTile<OSMVectorTileImpl<TDataAccess>>::output_path(m_config, bbox), "source"};
+            if (source_sidecar.read(source_state)) {
+                const double rows = tile_cost::recorded_rows(source_state);
+                if (rows >= 0) {
+                    return rows;
+                }
+            }
+        }
+        return m_vector_tile_impl.estimate_rows(bbox);
+    }
+
+    /**
+     * \brief Wait until the jobs of all tiles created by this worker have been written.
+     */
+    void flush_jobs() {
+        if (m_jobs_db) {
+            m_jobs_db->flush();
+        }
+    }
+
+    /**
+     * \brief Get the data access instance.
+     */
+    const TDataAccess& data_access() const {
+        return m_vector_tile_impl.data_access();
+    }
+};
+
+#endif /* SRC_TILE_WORKER_HPP_ */
@@ -9,6 +9,7 @@
 #define SRC_VECTOR_TILE_HPP_
 
 #include <set>
+#include "sidecar_file.hpp"
 #include "vectortile_generator_config.hpp"
 #include "jobs_database.hpp"
 
@@ -18,7 +19,8 @@
  * \tparam Vector tile implementation to use which builds the vector tile. This implementation should provide following
  * two public methods (there are no other public methods called):
  * * void TVectorTileImpl::clear(BoundingBox& bbox)
- * * void TVectorTileImpl::generate_vectortile(std::string& output_path)
+ * * bool TVectorTileImpl::generate_vectortile(std::string& output_path), returns false if the tile did not change
+ * * std::string TVectorTileImpl::source_state(const BoundingBox& bbox), used if m_precheck is set
  *
  * The implementation cares for everything which is related to the output format: querying the database (because some output
  * formats have a special area type, building the entities and writing the file).
@@ -55,32 +57,59 @@ public:
         m_implementation.clear(bbox);
     }
 
+    /**
+     * \brief Get the path of the file of a tile.
+     *
+     * \param config program configuration
+     * \param bbox bounding box of the tile
+     */
+    static std::string output_path(const VectortileGeneratorConfig& config, const BoundingBox& bbox) {
+        std::string path = config.m_output_path;
+        if (config.m_batch_mode) {
+            path += std::to_string(bbox.m_zoom);
+            path.push_back('_');
+            path += std::to_string(bbox.m_x);
+            path.push_back('_');
+            path += std::to_string(bbox.m_y);
+            path.push_back('.');
+            path += config.m_file_suffix;
+        }
+        return path;
+    }
+
     /**
      * \brief build the vector tile by calling the method of the choosen implementation and update the jobs database
+     *
+     * \returns path of the file written
      */
-    void generate_vectortile() {
+    std::string generate_vectortile() {
         // build path where to write the file
-        std::string output_path = m_config.m_output_path;
-        if (m_config.m_batch_mode) {
-            output_path += std::to_string(m_bbox.m_zoom);
-            output_path.push_back('_');
-            output_path += std::to_string(m_bbox.m_x);
-            output_path.push_back('_');
-            output_path += std::to_string(m_bbox.m_y);
-            output_path.push_back('.');
-            output_path += m_config.m_file_suffix;
-        }
+        std::string output_path = VectorTile::output_path(m_config, m_bbox);
 
         // get current time
         time_t rawtime;
+        struct tm time_buffer;
         struct tm * ptm;
         time (&rawtime);
-        ptm = gmtime(&rawtime);
+        ptm = gmtime_r(&rawtime, &time_buffer);
         char created[21];
-        sprintf(created, "%4d-%2d-%2dT%2d:%2d:%2dZ", ptm->tm_year, ptm->tm_mon, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
+        snprintf(created, sizeof(created), "%04d-%02d-%02dT%02d:%02d:%02dZ", ptm->tm_year + 1900, ptm->tm_mon + 1,
+                ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
+
+        // Skip the tile if the rows of its bounding box did not change since it was created.
+        SidecarFile source_sidecar {output_path, "source"};
+        std::string source_state;
+        if (m_config.m_precheck) {
+            source_state = m_implementation.source_state(m_bbox);
+            if (source_sidecar.matches(source_state)) {
+                return output_path;
+            }
+            source_sidecar.remove();
+        }
 
         // drop previous job if it has not been completed yet
-        if (m_jobs_db) { // If the user does not want to write jobs, the unique_ptr doesn't manage anything.
+        // If the content of unchanged tiles is kept, the job is replaced after the tile has been written.
+        if (m_jobs_db && !m_config.m_skip_unchanged) { // If the user does not want to write jobs, the unique_ptr doesn't manage anything.
             m_jobs_db->cancel_job(m_bbox.m_x, m_bbox.m_y, m_bbox.m_zoom);
             // check if file exists
             struct stat stat_result;
@@ -92,12 +121,25 @@ public:
             }
         }
 
-        m_implementation.generate_vectortile(output_path);
+        if (!m_implementation.generate_vectortile(output_path)) {
+            // The tile did not change, its job (if any) is still valid.
+            if (m_config.m_precheck) {
+                source_sidecar.store(source_state);
+            }
+            return output_path;
+        }
 
         // insert into jobs database
         if (m_jobs_db) { // If the user does not want to write jobs, the unique_ptr doesn't manage anything.
+            if (m_config.m_skip_unchanged) {
+                m_jobs_db->cancel_job(m_bbox.m_x, m_bbox.m_y, m_bbox.m_zoom);
+            }
             m_jobs_db->add_job(m_bbox.m_x, m_bbox.m_y, m_bbox.m_zoom, created, output_path.c_str());
         }
+        if (m_config.m_precheck) {
+            source_sidecar.store(source_state);
+        }
+        return output_path;
     }
 };
 
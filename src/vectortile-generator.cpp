@@ -6,15 +6,30 @@
  */
 
 
+#include <algorithm>
+#include <exception>
+#include <iomanip>
 #include <iostream>
 #include <getopt.h>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <postgres_drivers/columns.hpp>
+#include "concurrency_controller.hpp"
+#include "expire_watcher.hpp"
+#include "input/cached_data_access.hpp"
 #include "input/cerepso_data_access.hpp"
 #include "input/column_config_parser.hpp"
 #include "input/osm2pgsql_data_access.hpp"
+#include "metatile.hpp"
 #include "osmvectortileimpl.hpp"
+#include "tile_cost.hpp"
+#include "tile_list.hpp"
+#include "tile_order.hpp"
+#include "tile_queue.hpp"
+#include "tile_server.hpp"
+#include "tile_worker.hpp"
 #include "vectortile_generator_config.hpp"
 #include "vector_tile.hpp"
 
@@ -74,18 +89,30 @@
 void print_usage(char* argv[]) {
     std::cerr << "Usage: " << argv[0] << " [OPTIONS] [X] [Y] [Z] [OUTFILE]\n" \
                  "or     " << argv[0] << " [OPTIONS] [LOGFILE] [FORMAT] [OUTDIR]\n" \
+                 "or     " << argv[0] << " [OPTIONS] --serve=ADDRESS [FORMAT] [OUTDIR]\n" \
+                 "or     " << argv[0] << " [OPTIONS] --watch=DIR|--listen=CHANNEL [FORMAT] [OUTDIR]\n" \
+                 "or     " << argv[0] << " [OPTIONS] -j NAME --enqueue [LOGFILE]|--watch=DIR|--listen=CHANNEL\n" \
+                 "or     " << argv[0] << " [OPTIONS] -j NAME --queue-worker [FORMAT] [OUTDIR]\n" \
     "  [X]         x index of a tile\n" \
     "  [Y]         y index of a tile\n" \
     "  [Z]         zoom level of a tile\n" \
     "  [OUTFILE]   output file" \
-    "  [LOGFILE]   file containing a list of expired tiles\n" \
+    "  [LOGFILE]   file containing a list of expired tiles (zoom/x/y per line, optionally\n" \
+    "              compressed using gzip), '-' reads from standard input\n" \
     "  [FORMAT]    output format: 'osm', 'osm.pbf', 'opl'\n" \
-    "  [OUTDIR]    output directory\n" \
+    "  [OUTDIR]    output directory (optional in server mode)\n" \
     "  -h, --help                    print help and exit\n" \
     "  -v, --verbose                 be verbose\n" \
     "  -d NAME, --database-name=NAME name of the database where the OSM data is stored\n" \
+    "                                NAME can be a libpq connection string, e.g.\n" \
+    "                                \"host=localhost port=5433 dbname=gis\", or URI.\n" \
     "  -j NAME, --jobs-database=NAME name of the database where to write processing jobs\n" \
+    "                                NAME can be a libpq connection string, too.\n" \
     "                                This argument is mandatory if you want to write jobs.\n" \
+    "  --jobs-delay=MS               queue jobs for up to MS milliseconds and write them in batches\n" \
+    "                                using a background thread. All jobs of a tiles list are written\n" \
+    "                                before the program exits (or continues with the next list).\n" \
+    "                                Default: 0 (write each job immediately)\n" \
     "  -i NAME, --input=NAME         Use input driver called name.\n" \
     "                                Available drivers: cerepso, osm2pgsql\n" \
     "                                Default: cerepso\n" \
@@ -94,7 +121,8 @@ void print_usage(char* argv[]) {
     "                                you will do a sequential scan on that table! Using -O\n" \
     "                                will return you orphaned nodes you would not have got.\n" \
     "  -r, --recurse-relations       write relations to the output file which are\n" \
-    "                                referenced by other relations\n" \
+    "                                referenced by other relations. Nested relations\n" \
+    "                                are resolved recursively.\n" \
     "  -w, --recurse-ways            write ways to the output file which are beyond\n" \
     "                                the bounding box of the tile and referenced\n" \
     "                                by a relation\n" \
@@ -102,6 +130,20 @@ void print_usage(char* argv[]) {
     "                                the bounding box of the tile and referenced\n" \
     "                                by a relation\n" \
     "  -f, --force-overwrite         overwrite output file if it exists\n" \
+    "  --precheck=envelope           Cerepso input only: count the rows of each table inside the\n" \
+    "                                envelope of a tile and get their latest modification timestamp\n" \
+    "                                before creating the tile. The result is stored next to the tile\n" \
+    "                                (suffix .source). Tiles whose result did not change are not\n" \
+    "                                created again. Requires a column osm_lastmodified in all tables\n" \
+    "                                and --untagged-nodes-geom.\n" \
+    "                                This is an approximation: objects outside the envelope which are\n" \
+    "                                part of the tile are not checked. A tile is skipped wrongly and\n" \
+    "                                stays outdated if only such objects change, e.g. a node of a way\n" \
+    "                                of the tile which lies outside the envelope before and after it\n" \
+    "                                is moved, or members of relations added by -r, -w or -n.\n" \
+    "  --skip-unchanged              store a digest of the content of each tile in a file next to\n" \
+    "                                it (suffix .digest) and do not write tiles again (and do not\n" \
+    "                                add jobs for them) if their content did not change\n" \
     "  -s PATH, --style=PATH         Path to Osm2pgsql-like style file\n" \
     "  -F PATH, --flatnodes=PATH     path to flatnodes file if it should be used to retrieve untagged nodes\n" \
     "  --metadata=OPTARG             OSM output only: import specified metadata fields. Permitted values are \"none\", \"all\" and\n" \
@@ -109,24 +151,196 @@ void print_usage(char* argv[]) {
     "                                timestamp, user, uid, changeset.\n" \
     "                                Valid examples: \"none\" (no metadata), \"all\" (all fields),\n" \
     "                                \"version+timestamp\" (only version and timestamp).\n" \
+    "  --chunk-size=ROWS             stream the results of spatial queries from the database and\n" \
+    "                                process up to ROWS rows at once. This limits memory usage\n" \
+    "                                at low zoom levels. Default: 0 (fetch whole results)\n" \
+    "  --max-relation-depth=DEPTH    stop resolving nested relations for -r after DEPTH\n" \
+    "                                levels. Default: 0 (unlimited)\n" \
+    "  --async                       send the spatial queries for nodes, ways and relations of\n" \
+    "                                a tile at once using separate database connections\n" \
+    "  --threads=N                   create tiles using N worker threads, each of them with its\n" \
+    "                                own database connections. Applies to batch, continuous,\n" \
+    "                                queue worker and server mode (requests served in parallel).\n" \
+    "                                Maximum number of tiles created at once with --adaptive.\n" \
+    "                                Default: 1\n" \
+    "  --adaptive                    batch, continuous and queue worker mode: adapt the number of\n" \
+    "                                tiles created at once to the latency of the spatial queries\n" \
+    "                                (AIMD). Starts with one tile, --threads is the maximum.\n" \
+    "  --latency-tolerance=F         --adaptive only: create fewer tiles at once if the latency is\n" \
+    "                                F times higher than without load. Default: 2\n" \
+    "  --metatile=N                  batch mode only: fetch the data of blocks of NxN tiles of the\n" \
+    "                                same zoom level at once (N <= 8). Default: 1 (disabled)\n" \
+    "  --pyramid                     batch mode only: fetch the data of tiles together with the\n" \
+    "                                tiles of lower zoom levels in the list containing them.\n" \
+    "                                Cannot be combined with --metatile.\n" \
+    "  --cache-size=MB               batch mode only: keep up to MB megabytes of nodes, ways and\n" \
+    "                                relations of previous tiles in memory to avoid querying them\n" \
+    "                                again. Cannot be used in server or continuous mode or with\n" \
+    "                                --queue-worker. Default: 0 (disabled)\n" \
+    "  --sort=ORDER                  batch mode only: process the tiles along a space-filling\n" \
+    "                                curve, neighbouring tiles are processed one after another.\n" \
+    "                                Available orders: none, quadtree, hilbert. Default: none\n" \
+    "  --longest-first=ESTIMATE      create the tiles (or metatiles) with the highest predicted cost\n" \
+    "                                first. Tiles of equal cost keep the order of --sort.\n" \
+    "                                Available estimates:\n" \
+    "                                zoom: area of the tile\n" \
+    "                                explain: rows expected by the query planner (EXPLAIN)\n" \
+    "                                previous: rows counted by the previous run with\n" \
+    "                                --precheck=envelope, explain for tiles without a record\n" \
+    "  --dry-run                     print zoom/x/y and the predicted cost of each tile, most\n" \
+    "                                expensive first, instead of creating the tiles.\n" \
+    "                                Default estimate: explain\n" \
+    "  --serve=ADDRESS               run as server creating tiles on request. ADDRESS is the path of\n" \
+    "                                a Unix domain socket or [HOST:]PORT (default host: 127.0.0.1).\n" \
+    "                                Tiles are requested using HTTP GET /zoom/x/y and returned in the\n" \
+    "                                response. They are written to OUTDIR if it is given.\n" \
+    "                                --threads sets the number of requests served in parallel.\n" \
+    "  --tile-cache=MB               server mode only: keep up to MB megabytes of recently created\n" \
+    "                                tiles in memory. Default: 0 (disabled)\n" \
+    "  --tile-cache-ttl=SECONDS      server mode only: create cached tiles again after SECONDS.\n" \
+    "                                The cache is not invalidated if the database changes.\n" \
+    "                                0 disables the limit. Default: 60\n" \
+    "  --watch=DIR                   continuous mode: create the tiles of expire lists written to DIR.\n" \
+    "                                Lists are renamed to .NAME.processing when they are read and\n" \
+    "                                removed after their tiles have been created.\n" \
+    "  --listen=CHANNEL              continuous mode: create the tiles of notifications on the\n" \
+    "                                PostgreSQL channel CHANNEL (payload: expire list)\n" \
+    "  --enqueue                     add the tiles of the tiles list (or of the expire lists in\n" \
+    "                                continuous mode) to the table tile_queue in the jobs database\n" \
+    "                                instead of creating them\n" \
+    "  --queue-worker                claim batches of tiles from the table tile_queue in the jobs\n" \
+    "                                database and create them until the queue is empty. Any number\n" \
+    "                                of processes on any number of hosts can work on one queue.\n" \
+    "  --queue-batch=N               maximum number of tiles claimed at once. Default: 64\n" \
+    "  --lease=SECONDS               time after which the claim of tiles which were not created is\n" \
+    "                                taken over by other processes (crashed workers). Has to be\n" \
+    "                                longer than the creation of a batch takes. Default: 600\n" \
+    "  --zoom-range=MIN-MAX          batch mode only: replace each tile of the tiles list by its\n" \
+    "                                ancestors and descendants at zoom levels MIN to MAX. MAX may\n" \
+    "                                exceed the zoom level of a tile by 8 levels at most.\n" \
+    "  --collapse=ZOOM               batch mode only: replace tiles of the tiles list at zoom levels\n" \
+    "                                higher than ZOOM by their ancestor at ZOOM\n" \
     "The output format is detected automatically based on the suffix of the output file."<< std::endl;
     exit(1);
 }
 
-template <typename TOutput>
-void run(VectortileGeneratorConfig config, std::vector<BoundingBox> bboxes, TOutput&& vector_tile_impl) {
-    // initialize connection to jobs' database
-    std::unique_ptr<JobsDatabase> jobs_db;
-    if (config.m_jobs_database != "") {
-        jobs_db = std::unique_ptr<JobsDatabase>(new JobsDatabase(config.m_jobs_database));
-    }
+/**
+ * \brief Print statistics of a data access implementation if it provides any.
+ */
+template <typename TDataAccess>
+void print_statistics(const TDataAccess&) {
+}
 
-    for (BoundingBox& bbox : bboxes) {
-        if (config.m_verbose) {
-            std::cout << "Creating tile " << bbox.m_zoom << '/' << bbox.m_x << '/' << bbox.m_y << '\n';
+template <typename TDataAccess>
+void print_statistics(const input::CachedDataAccess<TDataAccess>& data_access) {
+    std::cout << "Object cache: " << data_access.hits() << " hits, " << data_access.misses() << " misses, "
+            << data_access.cached_objects() << " objects cached\n";
+}
+
+/**
+ * \brief Create all tiles of a list.
+ *
+ * In server mode, the tiles are created on request by a TileServer instead.
+ *
+ * \param config program configuration
+ * \param bboxes tiles to create
+ * \param column_parser parser of the style file, shared by all workers
+ *
+ * \tparam TDataAccess data access implementation
+ */
+template <typename TDataAccess>
+void run(VectortileGeneratorConfig& config, std::vector<BoundingBox>& bboxes, input::ColumnConfigParser& column_parser) {
+    if (config.m_serve_address != "") {
+        TileServer<TDataAccess> server {config, column_parser};
+        server.run();
+        return;
+    }
+    std::mutex output_mutex;
+    std::vector<std::unique_ptr<TileWorker<TDataAccess>>> workers(config.m_threads);
+    std::unique_ptr<ConcurrencyController> controller;
+    if (config.m_adaptive_concurrency) {
+        controller = std::unique_ptr<ConcurrencyController>(new ConcurrencyController(config.m_threads,
+                config.m_latency_tolerance));
+    }
+    std::unique_ptr<TileQueue> queue;
+    if (config.m_enqueue || config.m_queue_worker) {
+        queue = std::unique_ptr<TileQueue>(new TileQueue(config.m_jobs_database));
+    }
+    if (config.m_dry_run) {
+        // print the tiles in the order they would be created (metatiles are not taken into account)
+        std::vector<double> costs = estimate_costs(config, column_parser, workers, controller.get(), bboxes, output_mutex);
+        std::cout << std::fixed << std::setprecision(0);
+        for (const size_t i : tile_cost::longest_first(costs)) {
+            std::cout << bboxes[i].m_zoom << '/' << bboxes[i].m_x << '/' << bboxes[i].m_y << ' ' << costs[i] << '\n';
+        }
+        return;
+    }
+    if (config.m_queue_worker) {
+        // Claims of tiles which have not been created are released if a worker fails. If the
+        // process crashes, they are claimed by other processes after the lease expired.
+        while (true) {
+            bboxes = queue->claim(config.m_queue_batch, config.m_lease);
+            if (bboxes.empty()) {
+                break;
+            }
+            if (config.m_verbose) {
+                std::cout << "Claimed " << bboxes.size() << " tiles as " << queue->worker() << '\n';
+            }
+            tile_order::sort(bboxes, config.m_tile_order);
+            try {
+                create_tiles(config, column_parser, workers, controller.get(), bboxes, output_mutex);
+            } catch (...) {
+                queue->release(bboxes);
+                throw;
+            }
+            queue->complete(bboxes);
+        }
+    } else if (config.m_watch_directory == "" && config.m_listen_channel == "") {
+        if (config.m_enqueue) {
+            size_t count = queue->enqueue(bboxes);
+            if (config.m_verbose) {
+                std::cout << "Enqueued " << count << " tiles\n";
+            }
+        } else {
+            create_tiles(config, column_parser, workers, controller.get(), bboxes, output_mutex);
+        }
+    } else {
+        // continuous mode: the workers keep their connections between the lists of expired tiles
+        ExpireWatcher watcher {config};
+        TileList pending;
+        if (config.m_min_zoom >= 0) {
+            pending.set_zoom_range(config.m_min_zoom, config.m_max_zoom);
+        }
+        if (config.m_collapse_zoom >= 0) {
+            pending.set_collapse_zoom(config.m_collapse_zoom);
+        }
+        while (true) {
+            watcher.wait(pending);
+            bboxes = pending.bboxes();
+            tile_order::sort(bboxes, config.m_tile_order);
+            if (config.m_verbose) {
+                std::cout << "Read " << pending.tiles_read() << " expired tiles, " << pending.size()
+                        << " unique tiles to create\n";
+            }
+            if (config.m_enqueue) {
+                queue->enqueue(bboxes);
+            } else {
+                create_tiles(config, column_parser, workers, controller.get(), bboxes, output_mutex);
+            }
+            watcher.commit();
+            pending.clear();
+        }
+    }
+    if (config.m_verbose && controller) {
+        std::cout << "Concurrency limit: " << controller->limit() << " tiles, baseline latency of spatial queries: "
+                << controller->baseline() << " s\n";
+    }
+    if (config.m_verbose) {
+        for (std::unique_ptr<TileWorker<TDataAccess>>& worker : workers) {
+            if (worker) {
+                print_statistics(worker->data_access());
+            }
         }
-        VectorTile<TOutput> vector_tile(config, vector_tile_impl, bbox, jobs_db.get());
-        vector_tile.generate_vectortile();
     }
 }
 
@@ -143,6 +357,32 @@ int main(int argc, char* argv[]) {
             {"style", required_argument, 0, 's'},
             {"untagged-nodes-geom",  no_argument, 0, 200},
             {"metadata",  required_argument, 0, 201},
+            {"chunk-size",  required_argument, 0, 202},
+            {"async",  no_argument, 0, 203},
+            {"max-relation-depth",  required_argument, 0, 204},
+            {"threads",  required_argument, 0, 205},
+            {"metatile",  required_argument, 0, 206},
+            {"pyramid",  no_argument, 0, 207},
+            {"cache-size",  required_argument, 0, 208},
+            {"sort",  required_argument, 0, 209},
+            {"zoom-range",  required_argument, 0, 210},
+            {"collapse",  required_argument, 0, 211},
+            {"serve",  required_argument, 0, 212},
+            {"tile-cache",  required_argument, 0, 213},
+            {"watch",  required_argument, 0, 214},
+            {"listen",  required_argument, 0, 215},
+            {"skip-unchanged",  no_argument, 0, 216},
+            {"precheck",  required_argument, 0, 217},
+            {"longest-first",  required_argument, 0, 218},
+            {"dry-run",  no_argument, 0, 219},
+            {"enqueue",  no_argument, 0, 220},
+            {"queue-worker",  no_argument, 0, 221},
+            {"queue-batch",  required_argument, 0, 222},
+            {"lease",  required_argument, 0, 223},
+            {"adaptive",  no_argument, 0, 224},
+            {"latency-tolerance",  required_argument, 0, 225},
+            {"jobs-delay",  required_argument, 0, 226},
+            {"tile-cache-ttl",  required_argument, 0, 227},
             {"help",  no_argument, 0, 'h'},
             {0, 0, 0, 0}
         };
@@ -194,6 +434,153 @@ int main(int argc, char* argv[]) {
             case 201:
                 config.m_postgres_config.metadata = osmium::metadata_options(optarg);
                 break;
+            case 202:
+                config.m_chunk_size = atoi(optarg);
+                if (config.m_chunk_size < 0) {
+                    std::cerr << "ERROR: The chunk size must not be negative.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 203:
+                config.m_async_queries = true;
+                break;
+            case 204:
+                config.m_max_relation_depth = atoi(optarg);
+                if (config.m_max_relation_depth < 0) {
+                    std::cerr << "ERROR: The maximum relation depth must not be negative.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 205:
+                config.m_threads = atoi(optarg);
+                if (config.m_threads < 1) {
+                    std::cerr << "ERROR: At least one thread is required.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 206:
+                config.m_metatile_size = atoi(optarg);
+                if (config.m_metatile_size < 1 || config.m_metatile_size > 8) {
+                    std::cerr << "ERROR: The metatile size must be between 1 and 8.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 207:
+                config.m_pyramid = true;
+                break;
+            case 208:
+                if (atoi(optarg) < 0) {
+                    std::cerr << "ERROR: The cache size must not be negative.\n";
+                    print_usage(argv);
+                }
+                config.m_cache_size = static_cast<size_t>(atoi(optarg)) * 1024 * 1024;
+                break;
+            case 209:
+                try {
+                    config.m_tile_order = tile_order::parse(optarg);
+                } catch (std::runtime_error& e) {
+                    std::cerr << "ERROR: " << e.what() << '\n';
+                    print_usage(argv);
+                }
+                break;
+            case 210:
+                try {
+                    TileList::parse_zoom_range(optarg, config.m_min_zoom, config.m_max_zoom);
+                } catch (std::runtime_error& e) {
+                    std::cerr << "ERROR: " << e.what() << '\n';
+                    print_usage(argv);
+                }
+                break;
+            case 211:
+                config.m_collapse_zoom = atoi(optarg);
+                if (config.m_collapse_zoom < 0 || config.m_collapse_zoom > TileList::MAX_ZOOM) {
+                    std::cerr << "ERROR: The zoom level to collapse tiles to must be between 0 and "
+                            << TileList::MAX_ZOOM << ".\n";
+                    print_usage(argv);
+                }
+                break;
+            case 212:
+                config.m_serve_address = optarg;
+                break;
+            case 213:
+                if (atoi(optarg) < 0) {
+                    std::cerr << "ERROR: The tile cache size must not be negative.\n";
+                    print_usage(argv);
+                }
+                config.m_tile_cache_size = static_cast<size_t>(atoi(optarg)) * 1024 * 1024;
+                break;
+            case 214:
+                config.m_watch_directory = optarg;
+                break;
+            case 215:
+                config.m_listen_channel = optarg;
+                break;
+            case 216:
+                config.m_skip_unchanged = true;
+                break;
+            case 217:
+                // The only mode is named explicitly because it does not detect all changes.
+                if (std::string(optarg) != "envelope") {
+                    std::cerr << "ERROR: Unknown pre-check \"" << optarg << "\". Available: envelope\n";
+                    print_usage(argv);
+                }
+                config.m_precheck = true;
+                break;
+            case 218:
+                try {
+                    config.m_cost_estimate = tile_cost::parse(optarg);
+                } catch (std::runtime_error& e) {
+                    std::cerr << "ERROR: " << e.what() << '\n';
+                    print_usage(argv);
+                }
+                break;
+            case 219:
+                config.m_dry_run = true;
+                break;
+            case 220:
+                config.m_enqueue = true;
+                break;
+            case 221:
+                config.m_queue_worker = true;
+                break;
+            case 222:
+                config.m_queue_batch = atoi(optarg);
+                if (config.m_queue_batch < 1) {
+                    std::cerr << "ERROR: At least one tile has to be claimed at once.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 223:
+                config.m_lease = atoi(optarg);
+                if (config.m_lease < 1) {
+                    std::cerr << "ERROR: The lease must be at least one second.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 224:
+                config.m_adaptive_concurrency = true;
+                break;
+            case 225:
+                config.m_latency_tolerance = atof(optarg);
+                if (config.m_latency_tolerance <= 1) {
+                    std::cerr << "ERROR: The latency tolerance must be greater than 1.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 226:
+                config.m_jobs_delay = atoi(optarg);
+                if (config.m_jobs_delay < 0) {
+                    std::cerr << "ERROR: The delay of jobs must not be negative.\n";
+                    print_usage(argv);
+                }
+                break;
+            case 227:
+                config.m_tile_cache_ttl = atoi(optarg);
+                if (config.m_tile_cache_ttl < 0) {
+                    std::cerr << "ERROR: The maximum age of cached tiles must not be negative.\n";
+                    print_usage(argv);
+                }
+                break;
             case 'h':
                 print_usage(argv);
                 break;
@@ -202,22 +589,119 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (config.m_precheck && (config.m_input != "cerepso" || config.m_flatnodes_path != ""
+            || !config.m_untagged_nodes_geom)) {
+        // Moved untagged nodes could not be detected.
+        std::cerr << "ERROR: --precheck=envelope requires the Cerepso input with --untagged-nodes-geom and without flatnodes.\n";
+        print_usage(argv);
+    }
+    if (config.m_dry_run && config.m_cost_estimate == CostEstimate::NONE) {
+        config.m_cost_estimate = CostEstimate::EXPLAIN;
+    }
+    if (config.m_dry_run && (config.m_serve_address != "" || config.m_watch_directory != ""
+            || config.m_listen_channel != "")) {
+        std::cerr << "ERROR: --dry-run cannot be used in server or continuous mode.\n";
+        print_usage(argv);
+    }
+    if ((config.m_enqueue || config.m_queue_worker) && config.m_jobs_database == "") {
+        std::cerr << "ERROR: The tile queue requires a jobs database (-j).\n";
+        print_usage(argv);
+    }
+    if (config.m_enqueue && config.m_queue_worker) {
+        std::cerr << "ERROR: --enqueue and --queue-worker cannot be combined.\n";
+        print_usage(argv);
+    }
+    if ((config.m_enqueue || config.m_queue_worker) && (config.m_serve_address != "" || config.m_dry_run)) {
+        std::cerr << "ERROR: The tile queue cannot be used in server mode or with --dry-run.\n";
+        print_usage(argv);
+    }
+    if (config.m_adaptive_concurrency && config.m_serve_address != "") {
+        std::cerr << "ERROR: --adaptive cannot be used in server mode.\n";
+        print_usage(argv);
+    }
+    if (config.m_queue_worker && (config.m_watch_directory != "" || config.m_listen_channel != "")) {
+        std::cerr << "ERROR: --queue-worker cannot be used in continuous mode.\n";
+        print_usage(argv);
+    }
+    // The cache is not invalidated if the database is updated.
+    if (config.m_cache_size > 0 && (config.m_serve_address != "" || config.m_watch_directory != ""
+            || config.m_listen_channel != "" || config.m_queue_worker)) {
+        std::cerr << "ERROR: --cache-size can only be used in batch mode.\n";
+        print_usage(argv);
+    }
+    if (config.m_pyramid && config.m_metatile_size > 1) {
+        std::cerr << "ERROR: --pyramid and --metatile cannot be combined.\n";
+        print_usage(argv);
+    }
+
     int remaining_args = argc - optind;
     std::vector<BoundingBox> bboxes;
-    if (remaining_args == 4) {
+    if (config.m_serve_address != "") {
+        if (config.metatiles_enabled()) {
+            std::cerr << "ERROR: --metatile and --pyramid cannot be used in server mode.\n";
+            print_usage(argv);
+        }
+        if (remaining_args < 1 || remaining_args > 2) {
+            print_usage(argv);
+        }
+        // Tiles are named like in batch mode and replace older versions of themselves.
+        config.m_batch_mode = true;
+        config.m_force = true;
+        config.m_file_suffix = argv[optind];
+        config.m_output_path = "";
+        if (remaining_args == 2) {
+            config.m_output_path = argv[optind+1];
+            if (config.m_output_path.back() != '/') {
+                config.m_output_path.push_back('/');
+            }
+        }
+    } else if (config.m_watch_directory != "" || config.m_listen_channel != "" || config.m_queue_worker) {
+        // Expired tiles are only added to the tile queue if --enqueue is given.
+        if (remaining_args != (config.m_enqueue ? 0 : 2)) {
+            print_usage(argv);
+        }
+        config.m_batch_mode = true;
+        config.m_force = true;
+        if (remaining_args == 2) {
+            config.m_file_suffix = argv[optind];
+            config.m_output_path = argv[optind+1];
+            if (config.m_output_path.back() != '/') {
+                config.m_output_path.push_back('/');
+            }
+        }
+    } else if (remaining_args == 4) {
         config.m_x = atoi(argv[optind]);
         config.m_y = atoi(argv[optind+1]);
         config.m_zoom = atoi(argv[optind+2]);
         config.m_output_path =  argv[optind+3];
         bboxes.push_back(BoundingBox(config));
-    } else if (remaining_args == 3) {
+    } else if (remaining_args == 3 || (remaining_args == 1 && config.m_enqueue)) {
         config.m_batch_mode = true;
-        bboxes = BoundingBox::read_tiles_list(argv[optind]);
-        config.m_file_suffix =  argv[optind+1];
-        config.m_output_path =  argv[optind+2];
-        // check if last character of the output path is a slash
-        if (config.m_output_path.back() != '/') {
-            config.m_output_path.push_back('/');
+        TileList tiles;
+        try {
+            if (config.m_min_zoom >= 0) {
+                tiles.set_zoom_range(config.m_min_zoom, config.m_max_zoom);
+            }
+            if (config.m_collapse_zoom >= 0) {
+                tiles.set_collapse_zoom(config.m_collapse_zoom);
+            }
+            tiles.read(argv[optind]);
+        } catch (std::runtime_error& e) {
+            std::cerr << "ERROR: " << e.what() << '\n';
+            exit(1);
+        }
+        if (config.m_verbose) {
+            std::cout << "Read " << tiles.tiles_read() << " tiles, " << tiles.size() << " unique tiles to create\n";
+        }
+        bboxes = tiles.bboxes();
+        tile_order::sort(bboxes, config.m_tile_order);
+        if (remaining_args == 3) {
+            config.m_file_suffix =  argv[optind+1];
+            config.m_output_path =  argv[optind+2];
+            // check if last character of the output path is a slash
+            if (config.m_output_path.back() != '/') {
+                config.m_output_path.push_back('/');
+            }
         }
     } else {
         print_usage(argv);
@@ -228,14 +712,14 @@ int main(int argc, char* argv[]) {
         column_parser.parse();
     }
 
-    if (config.m_input == "cerepso") {
-        input::CerepsoDataAccess data_access {config, column_parser};
-        OSMVectorTileImpl<input::CerepsoDataAccess> vector_tile_impl {config, std::move(data_access)};
-        run<OSMVectorTileImpl<input::CerepsoDataAccess>>(config, bboxes, std::move(vector_tile_impl));
+    if (config.m_input == "cerepso" && config.m_cache_size > 0) {
+        run<input::CachedDataAccess<input::CerepsoDataAccess>>(config, bboxes, column_parser);
+    } else if (config.m_input == "cerepso") {
+        run<input::CerepsoDataAccess>(config, bboxes, column_parser);
+    } else if (config.m_input == "osm2pgsql" && config.m_cache_size > 0) {
+        run<input::CachedDataAccess<input::Osm2pgsqlDataAccess>>(config, bboxes, column_parser);
     } else if (config.m_input == "osm2pgsql") {
-        input::Osm2pgsqlDataAccess data_access {config, column_parser};
-        OSMVectorTileImpl<input::Osm2pgsqlDataAccess> vector_tile_impl {config, std::move(data_access)};
-        run<OSMVectorTileImpl<input::Osm2pgsqlDataAccess>>(config, bboxes, std::move(vector_tile_impl));
+        run<input::Osm2pgsqlDataAccess>(config, bboxes, column_parser);
     } else {
         std::cerr << "ERROR: Unsupported input \"" << config.m_input << "\"\n";
         print_usage(argv);
@@ -9,6 +9,8 @@
 #define SRC_VECTORTILE_GENERATOR_CONFIG_HPP_
 
 #include <postgres_drivers/config.hpp>
+#include "tile_cost.hpp"
+#include "tile_order.hpp"
 
 struct VectortileGeneratorConfig {
     /// database access related configuration
@@ -34,6 +36,103 @@ struct VectortileGeneratorConfig {
     /// true if we create multiple tiles at once
     bool m_batch_mode = false;
 
+    /// number of worker threads in batch mode, each of them uses its own database connections
+    int m_threads = 1;
+
+    /**
+     * \brief Address to serve tile requests on (server mode)
+     *
+     * Path of a Unix domain socket or `[HOST:]PORT`. An empty string disables the server mode.
+     */
+    std::string m_serve_address = "";
+
+    /// maximum memory usage of the cache of created tiles in server mode in bytes, 0 disables the cache
+    size_t m_tile_cache_size = 0;
+
+    /// maximum age of tiles in the cache of created tiles in seconds, 0 means unlimited
+    int m_tile_cache_ttl = 60;
+
+    /// directory to watch for lists of expired tiles (continuous mode), empty if not used
+    std::string m_watch_directory = "";
+
+    /// PostgreSQL channel to listen on for expired tiles (continuous mode), empty if not used
+    std::string m_listen_channel = "";
+
+    /// add the tiles to the tile queue in the jobs database instead of creating them, see TileQueue
+    bool m_enqueue = false;
+
+    /// create the tiles of the tile queue in the jobs database until it is empty
+    bool m_queue_worker = false;
+
+    /// maximum number of tiles claimed from the tile queue at once
+    int m_queue_batch = 64;
+
+    /// duration of a claim of tiles from the tile queue in seconds
+    int m_lease = 600;
+
+    /**
+     * \brief width and height of metatiles in tiles
+     *
+     * Tiles of a metatile are fetched from the database using one set of spatial queries.
+     * 1 disables metatiles.
+     */
+    int m_metatile_size = 1;
+
+    /**
+     * \brief Group tiles with the tiles of lower zoom levels containing them?
+     *
+     * The data of all tiles below a tile of the lowest zoom level is fetched by one set of
+     * spatial queries.
+     */
+    bool m_pyramid = false;
+
+    /**
+     * \brief Maximum memory usage of the cache of objects of previous tiles in bytes
+     *
+     * 0 disables the cache. See input::CachedDataAccess.
+     */
+    size_t m_cache_size = 0;
+
+    /**
+     * \brief Range of zoom levels to expand the tiles of the tiles list to
+     *
+     * -1 disables the expansion. See TileList::set_zoom_range().
+     */
+    int m_min_zoom = -1;
+    int m_max_zoom = -1;
+
+    /**
+     * \brief Zoom level to collapse tiles of higher zoom levels in the tiles list to
+     *
+     * -1 disables collapsing. See TileList::set_collapse_zoom().
+     */
+    int m_collapse_zoom = -1;
+
+    /// order in which the tiles of a batch are processed
+    TileOrder m_tile_order = TileOrder::NONE;
+
+    /// cost estimate used to create the most expensive tiles first
+    CostEstimate m_cost_estimate = CostEstimate::NONE;
+
+    /**
+     * \brief maximum time in milliseconds additions and cancellations of jobs are queued before they
+     * are written to the jobs database, 0 writes them immediately
+     */
+    int m_jobs_delay = 0;
+
+    /// print the predicted cost of each tile instead of creating the tiles
+    bool m_dry_run = false;
+
+    /**
+     * \brief Adapt the number of tiles created at once to the latency of the spatial queries.
+     *
+     * See ConcurrencyController. m_threads is the maximum.
+     */
+    bool m_adaptive_concurrency = false;
+
+    /// tolerated ratio of the latency of the spatial queries and their latency without load
+    double m_latency_tolerance = 2.0;
+
     /// Do a spatial query on `untagged_nodes` table?
     bool m_orphaned_nodes = false;
     /// be verbose on command line
@@ -48,6 +147,13 @@ struct VectortileGeneratorConfig {
      */
     bool m_recurse_relations = false;
 
+    /**
+     * \brief Maximum nesting depth of relations fetched because of m_recurse_relations
+     *
+     * 0 means unlimited. Cycles in the relation graph are detected in any case.
+     */
+    int m_max_relation_depth = 0;
+
     /**
      * \brief Fetch ways from the database which are not included in
      * the tile but referenced by relations which are included in the
@@ -69,6 +175,24 @@ struct VectortileGeneratorConfig {
      */
     bool m_force = false;
 
+    /**
+     * \brief Keep tiles whose content did not change?
+     *
+     * The digest of the content of each tile is stored next to it, see ContentDigest. Unchanged tiles
+     * are neither written nor added to the jobs database.
+     */
+    bool m_skip_unchanged = false;
+
+    /**
+     * \brief Check if the source data of a tile changed before creating it?
+     *
+     * A summary of the rows of each table inside the envelope of the tile is stored next to the
+     * tile, see SidecarFile. Tiles whose summary did not change are not created again. Objects
+     * outside the envelope (nodes of ways, members of relations) are not covered by the summary,
+     * changes affecting only them are missed (option `--precheck=envelope`).
+     */
+    bool m_precheck = false;
+
     /// x index of the tile to be generated
     int m_x;
     /// y index of the tile to be generated
@@ -87,12 +211,32 @@ struct VectortileGeneratorConfig {
      */
     std::string m_flatnodes_path = "";
 
+    /**
+     * \brief Number of rows of the results of spatial queries processed at once.
+     *
+     * The rows are streamed from the database. 0 fetches the whole result before processing it.
+     */
+    int m_chunk_size = 0;
+
+    /**
+     * \brief Send the spatial queries for nodes, ways and relations of a tile at once
+     * using separate database connections?
+     */
+    bool m_async_queries = false;
+
     VectortileGeneratorConfig() :
         m_x(),
         m_y(),
         m_zoom() {
         m_postgres_config.m_database_name = "pgimportertest";
     }
+
+    /**
+     * \brief Do spatial queries fetch the data of multiple tiles at once (metatile or pyramid mode)?
+     */
+    bool metatiles_enabled() const {
+        return m_metatile_size > 1 || m_pyramid;
+    }
 };
 
 
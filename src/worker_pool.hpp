@@ -0,0 +1,233 @@
+/*
+ * worker_pool.hpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_WORKER_POOL_HPP_
+#define SRC_WORKER_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bounding_box.hpp"
+#include "concurrency_controller.hpp"
+#include "metatile.hpp"
+#include "tile_cost.hpp"
+#include "vectortile_generator_config.hpp"
+
+namespace input {
+    class ColumnConfigParser;
+}
+
+/**
+ * \brief Process work items using multiple workers.
+ *
+ * The workers take the next item until all items are done. Missing workers are created by the
+ * thread using them. If a worker fails, the other workers stop after their current item and the
+ * exception is rethrown.
+ *
+ * If a controller is given, it is passed to the workers created by this function. If throttle is
+ * set, a worker waits for the controller before processing an item. The number of threads is
+ * still given by the number of workers.
+ *
+ * \param config program configuration
+ * \param column_parser parser of the style file, shared by all workers
+ * \param workers workers, one per thread, empty entries are created on demand
+ * \param controller controller of the number of items processed at once, may be nullptr
+ * \param work_count number of work items
+ * \param output_mutex mutex serializing messages written to the standard output
+ * \param process function processing an item using a worker
+ * \param throttle limit the number of items processed at once using the controller
+ *
+ * \tparam TWorker worker class, see TileWorker
+ */
+template <typename TWorker>
+void run_workers(VectortileGeneratorConfig& config, input::ColumnConfigParser& column_parser,
+        std::vector<std::unique_ptr<TWorker>>& workers, ConcurrencyController* controller,
+        const size_t work_count, std::mutex& output_mutex,
+        std::function<void(TWorker&, const size_t)> process, const bool throttle = true) {
+    std::atomic<size_t> next_item {0};
+    ConcurrencyController* limiter = throttle ? controller : nullptr;
+
+    auto work = [&](const size_t t) {
+        if (!workers[t]) {
+            workers[t] = std::unique_ptr<TWorker>(new TWorker(config,
+                    column_parser, output_mutex, controller));
+        }
+        TWorker& worker = *workers[t];
+        while (true) {
+            if (limiter) {
+                limiter->acquire();
+            }
+            // The next item is taken after waiting. Otherwise, waiting workers would delay items
+            // which other workers could process.
+            const size_t i = next_item++;
+            if (i >= work_count) {
+                if (limiter) {
+                    limiter->release();
+                }
+                break;
+            }
+            try {
+                process(worker, i);
+            } catch (...) {
+                if (limiter) {
+                    limiter->release();
+                }
+                throw;
+            }
+            if (limiter) {
+                limiter->release();
+            }
+        }
+    };
+
+    size_t thread_count = std::min(workers.size(), work_count);
+    if (thread_count <= 1) {
+        if (work_count > 0) {
+            work(0);
+        }
+        return;
+    }
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            try {
+                work(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+                // let the other workers stop
+                next_item = work_count;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * \brief Predict the cost of creating each tile of a list using the cost estimate of the configuration.
+ *
+ * \param config program configuration
+ * \param column_parser parser of the style file, shared by all workers
+ * \param workers workers, one per thread, empty entries are created on demand
+ * \param controller controller passed to new workers, may be nullptr
+ * \param bboxes tiles
+ * \param output_mutex mutex serializing messages written to the standard output
+ *
+ * \returns cost of each tile
+ *
+ * \tparam TWorker worker class, see TileWorker
+ */
+template <typename TWorker>
+std::vector<double> estimate_costs(VectortileGeneratorConfig& config, input::ColumnConfigParser& column_parser,
+        std::vector<std::unique_ptr<TWorker>>& workers, ConcurrencyController* controller,
+        const std::vector<BoundingBox>& bboxes, std::mutex& output_mutex) {
+    std::vector<double> costs(bboxes.size());
+    if (config.m_cost_estimate == CostEstimate::ZOOM) {
+        int max_zoom = 0;
+        for (const BoundingBox& bbox : bboxes) {
+            max_zoom = std::max(max_zoom, bbox.m_zoom);
+        }
+        for (size_t i = 0; i < bboxes.size(); ++i) {
+            costs[i] = tile_cost::zoom_cost(bboxes[i].m_zoom, max_zoom);
+        }
+        return costs;
+    }
+    // The estimates are not limited by the controller, EXPLAIN does not execute the queries. The
+    // workers created here are used to create the tiles afterwards, they report to the controller.
+    run_workers<TWorker>(config, column_parser, workers, controller, bboxes.size(), output_mutex,
+            [&](TWorker& worker, const size_t i) {
+        costs[i] = worker.estimate_cost(bboxes[i]);
+    }, false);
+    return costs;
+}
+
+/**
+ * \brief Create all tiles of a list using multiple workers.
+ *
+ * The workers take the next tile (or metatile if metatiles are enabled) from the list until all
+ * tiles are done, see run_workers(). If a cost estimate is configured, the most expensive tiles
+ * (or metatiles) are created first. Otherwise, the order of the list is kept.
+ *
+ * The jobs of the tiles have been written to the jobs database when this function returns.
+ *
+ * \param config program configuration
+ * \param column_parser parser of the style file, shared by all workers
+ * \param workers workers, one per thread, empty entries are created on demand
+ * \param controller controller of the number of tiles created at once, may be nullptr
+ * \param bboxes tiles to create
+ * \param output_mutex mutex serializing messages written to the standard output
+ *
+ * \tparam TWorker worker class, see TileWorker
+ */
+template <typename TWorker>
+void create_tiles(VectortileGeneratorConfig& config, input::ColumnConfigParser& column_parser,
+        std::vector<std::unique_ptr<TWorker>>& workers, ConcurrencyController* controller,
+        std::vector<BoundingBox>& bboxes, std::mutex& output_mutex) {
+    std::vector<Metatile> metatiles;
+    if (config.m_pyramid) {
+        metatiles = Metatile::group_pyramids(bboxes);
+    } else if (config.m_metatile_size > 1) {
+        metatiles = Metatile::group(bboxes, config.m_metatile_size);
+    }
+    const size_t work_count = metatiles.empty() ? bboxes.size() : metatiles.size();
+
+    std::vector<size_t> order;
+    if (config.m_cost_estimate != CostEstimate::NONE) {
+        if (metatiles.empty()) {
+            order = tile_cost::longest_first(estimate_costs(config, column_parser, workers, controller, bboxes,
+                    output_mutex));
+        } else {
+            // The cost of a metatile is the sum of the costs of its tiles.
+            std::vector<BoundingBox> tiles;
+            for (const Metatile& metatile : metatiles) {
+                tiles.insert(tiles.end(), metatile.tiles().begin(), metatile.tiles().end());
+            }
+            std::vector<double> tile_costs = estimate_costs(config, column_parser, workers, controller, tiles,
+                    output_mutex);
+            std::vector<double> costs(metatiles.size(), 0);
+            size_t t = 0;
+            for (size_t i = 0; i < metatiles.size(); ++i) {
+                for (size_t j = 0; j < metatiles[i].tiles().size(); ++j, ++t) {
+                    costs[i] += tile_costs[t];
+                }
+            }
+            order = tile_cost::longest_first(costs);
+        }
+    }
+
+    run_workers<TWorker>(config, column_parser, workers, controller, work_count, output_mutex,
+            [&](TWorker& worker, size_t i) {
+        if (!order.empty()) {
+            i = order[i];
+        }
+        if (metatiles.empty()) {
+            worker.create_tile(bboxes[i]);
+        } else {
+            worker.create_metatile(metatiles[i]);
+        }
+    });
+    for (std::unique_ptr<TWorker>& worker : workers) {
+        if (worker) {
+            worker->flush_jobs();
+        }
+    }
+}
+
+#endif /* SRC_WORKER_POOL_HPP_ */
@@ -0,0 +1,121 @@
+/*
+ * test_binary_result.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <string>
+#include <vector>
+#include <binary_result.hpp>
+
+TEST_CASE("Test decoding of integers in network byte order") {
+
+    SECTION("smallint") {
+        const char data[] = {'\x01', '\x02'};
+        REQUIRE(binary_result::decode_int2(data) == 258);
+    }
+
+    SECTION("negative smallint") {
+        const char data[] = {'\xff', '\xfe'};
+        REQUIRE(binary_result::decode_int2(data) == -2);
+    }
+
+    SECTION("integer") {
+        const char data[] = {'\x00', '\x01', '\x00', '\x02'};
+        REQUIRE(binary_result::decode_int4(data) == 65538);
+    }
+
+    SECTION("negative integer") {
+        const char data[] = {'\xff', '\xff', '\xff', '\xff'};
+        REQUIRE(binary_result::decode_int4(data) == -1);
+    }
+
+    SECTION("bigint") {
+        const char data[] = {'\x00', '\x00', '\x00', '\x01', '\x00', '\x00', '\x00', '\x02'};
+        REQUIRE(binary_result::decode_int8(data) == 4294967298);
+    }
+
+    SECTION("negative bigint") {
+        const char data[] = {'\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xf6'};
+        REQUIRE(binary_result::decode_int8(data) == -10);
+    }
+}
+
+TEST_CASE("Test decoding of double precision and timestamps") {
+
+    SECTION("double precision") {
+        // 1.5
+        const char data[] = {'\x3f', '\xf8', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00'};
+        REQUIRE(binary_result::decode_float8(data) == 1.5);
+    }
+
+    SECTION("timestamp at PostgreSQL epoch") {
+        const char data[] = {'\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00'};
+        REQUIRE(binary_result::decode_timestamptz(data) == 946684800);
+    }
+
+    SECTION("timestamp before PostgreSQL epoch") {
+        // -1.5 seconds
+        const char data[] = {'\xff', '\xff', '\xff', '\xff', '\xff', '\xe9', '\x1c', '\xa0'};
+        REQUIRE(binary_result::decode_timestamptz(data) == 946684798);
+    }
+}
+
+TEST_CASE("Test decoding of WKB points") {
+
+    SECTION("little endian WKB") {
+        // POINT(8.5 -1.25)
+        const char data[] = {'\x01', '\x01', '\x00', '\x00', '\x00',
+            '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x21', '\x40',
+            '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xf4', '\xbf'};
+        osmium::Location location = binary_result::decode_wkb_point(data, sizeof(data));
+        REQUIRE(location == osmium::Location(8.5, -1.25));
+    }
+
+    SECTION("big endian EWKB with SRID") {
+        // SRID=4326;POINT(8.5 -1.25)
+        const char data[] = {'\x00', '\x20', '\x00', '\x00', '\x01', '\x00', '\x00', '\x10', '\xe6',
+            '\x40', '\x21', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+            '\xbf', '\xf4', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00'};
+        osmium::Location location = binary_result::decode_wkb_point(data, sizeof(data));
+        REQUIRE(location == osmium::Location(8.5, -1.25));
+    }
+
+    SECTION("linestring") {
+        const char data[] = {'\x01', '\x02', '\x00', '\x00', '\x00',
+            '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x21', '\x40',
+            '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xf4', '\xbf'};
+        REQUIRE_THROWS_AS(binary_result::decode_wkb_point(data, sizeof(data)), std::runtime_error&);
+    }
+
+    SECTION("too short") {
+        const char data[] = {'\x01', '\x01', '\x00', '\x00', '\x00'};
+        REQUIRE_THROWS_AS(binary_result::decode_wkb_point(data, sizeof(data)), std::runtime_error&);
+    }
+}
+
+TEST_CASE("Test encoding of bigint arrays") {
+
+    SECTION("empty array") {
+        std::vector<int64_t> ids;
+        std::string array = binary_result::encode_int8_array(ids.begin(), ids.end());
+        REQUIRE(array.size() == 20);
+        REQUIRE(binary_result::decode_uint32(array.data()) == 1);
+        REQUIRE(binary_result::decode_uint32(array.data() + 8) == binary_result::INT8_OID);
+        REQUIRE(binary_result::decode_uint32(array.data() + 12) == 0);
+    }
+
+    SECTION("array with negative and large values") {
+        std::vector<int64_t> ids {5, -3, 6000000000};
+        std::string array = binary_result::encode_int8_array(ids.begin(), ids.end());
+        REQUIRE(array.size() == 20 + 3 * 12);
+        REQUIRE(binary_result::decode_uint32(array.data() + 12) == 3);
+        REQUIRE(binary_result::decode_uint32(array.data() + 16) == 1);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            REQUIRE(binary_result::decode_uint32(array.data() + 20 + i * 12) == 8);
+            REQUIRE(binary_result::decode_int8(array.data() + 24 + i * 12) == ids.at(i));
+        }
+    }
+}
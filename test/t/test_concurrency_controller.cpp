@@ -0,0 +1,95 @@
+/*
+ * test_concurrency_controller.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <atomic>
+#include <thread>
+#include <concurrency_controller.hpp>
+
+namespace {
+
+    void record_window(ConcurrencyController& controller, const int milliseconds) {
+        for (int i = 0; i < ConcurrencyController::WINDOW_QUERIES; ++i) {
+            controller.record(std::chrono::milliseconds(milliseconds));
+        }
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Test concurrency controller") {
+    ConcurrencyController controller {8, 2.0};
+    REQUIRE(controller.limit() == 1);
+    REQUIRE(controller.baseline() < 0);
+
+    SECTION("limit increases additively up to the maximum") {
+        record_window(controller, 10);
+        REQUIRE(controller.limit() == 2);
+        REQUIRE(controller.baseline() == Approx(0.01));
+        for (int i = 0; i < 20; ++i) {
+            record_window(controller, 10);
+        }
+        REQUIRE(controller.limit() == 8);
+    }
+
+    SECTION("limit decreases multiplicatively if the latency rises") {
+        for (int i = 0; i < 7; ++i) {
+            record_window(controller, 10);
+        }
+        REQUIRE(controller.limit() == 8);
+        record_window(controller, 30);
+        REQUIRE(controller.limit() == 6);
+        record_window(controller, 30);
+        REQUIRE(controller.limit() == 4);
+        // congested windows do not change the baseline
+        REQUIRE(controller.baseline() == Approx(0.01));
+        record_window(controller, 15);
+        REQUIRE(controller.limit() == 5);
+    }
+
+    SECTION("limit does not fall below one") {
+        record_window(controller, 10);
+        for (int i = 0; i < 10; ++i) {
+            record_window(controller, 100);
+        }
+        REQUIRE(controller.limit() == 1);
+        // The baseline follows the latency at a single tile at once.
+        REQUIRE(controller.baseline() > 0.01);
+    }
+
+    SECTION("incomplete windows do not change the limit") {
+        controller.record(std::chrono::milliseconds(10));
+        REQUIRE(controller.limit() == 1);
+    }
+}
+
+TEST_CASE("Test concurrency controller limits tiles at once") {
+    ConcurrencyController controller {4, 2.0};
+    record_window(controller, 10);
+    REQUIRE(controller.limit() == 2);
+    std::atomic<int> inflight {0};
+    std::atomic<int> max_inflight {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 6; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 20; ++i) {
+                controller.acquire();
+                int current = ++inflight;
+                int seen = max_inflight;
+                while (current > seen && !max_inflight.compare_exchange_weak(seen, current)) {
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                --inflight;
+                controller.release();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(max_inflight <= 2);
+    REQUIRE(inflight == 0);
+}
@@ -0,0 +1,26 @@
+/*
+ * test_connection_manager.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <connection_manager.hpp>
+
+TEST_CASE("Test building libpq connection strings") {
+
+    SECTION("database name") {
+        REQUIRE(ConnectionManager::conninfo("gis") == "dbname=gis");
+    }
+
+    SECTION("connection string") {
+        REQUIRE(ConnectionManager::conninfo("host=/var/run/postgresql port=5433 dbname=gis")
+                == "host=/var/run/postgresql port=5433 dbname=gis");
+    }
+
+    SECTION("connection URIs") {
+        REQUIRE(ConnectionManager::conninfo("postgresql://localhost:5433/gis") == "postgresql://localhost:5433/gis");
+        REQUIRE(ConnectionManager::conninfo("postgres://localhost/gis") == "postgres://localhost/gis");
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * test_content_digest.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <content_digest.hpp>
+
+TEST_CASE("Test content digest") {
+
+    SECTION("FNV-1a test vectors") {
+        REQUIRE(ContentDigest{}.hex() == "cbf29ce484222325");
+        ContentDigest digest;
+        digest.update("a", 1);
+        REQUIRE(digest.hex() == "af63dc4c8601ec8c");
+    }
+
+    SECTION("equal content gives equal digests") {
+        ContentDigest a;
+        a.update("foo", 3);
+        a.update("bar", 3);
+        ContentDigest b;
+        b.update("foobar", 6);
+        REQUIRE(a.hex() == b.hex());
+        ContentDigest c;
+        c.update("foobaz", 6);
+        REQUIRE(a.hex() != c.hex());
+    }
+}
+
+TEST_CASE("Test sidecar files") {
+    std::string path = "test_content_digest.osm";
+    SidecarFile sidecar = ContentDigest::sidecar(path);
+    REQUIRE(sidecar.path() == "test_content_digest.osm.digest");
+    std::remove(path.c_str());
+    sidecar.remove();
+
+    REQUIRE_FALSE(sidecar.matches("0123"));
+    sidecar.store("0123");
+    // the tile itself is missing
+    REQUIRE_FALSE(sidecar.matches("0123"));
+    {
+        std::ofstream tile {path};
+        tile << "content";
+    }
+    REQUIRE(sidecar.matches("0123"));
+    REQUIRE_FALSE(sidecar.matches("4567"));
+    sidecar.remove();
+    REQUIRE_FALSE(sidecar.matches("0123"));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,49 @@
+/*
+ * test_http_server.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <sys/stat.h>
+#include <fstream>
+#include <http_server.hpp>
+
+TEST_CASE("Test parsing of tile requests") {
+
+    SECTION("valid requests") {
+        http_server::Request request = http_server::parse_request("GET /14/8580/5640 HTTP/1.1\r\nHost: localhost\r\n\r\n", "osm.pbf");
+        REQUIRE(request.status == 200);
+        REQUIRE(request.zoom == 14);
+        REQUIRE(request.x == 8580);
+        REQUIRE(request.y == 5640);
+        request = http_server::parse_request("GET /0/0/0.osm.pbf?nocache HTTP/1.0\r\n\r\n", "osm.pbf");
+        REQUIRE(request.status == 200);
+        REQUIRE(request.zoom == 0);
+    }
+
+    SECTION("invalid requests") {
+        REQUIRE(http_server::parse_request("POST /14/8580/5640 HTTP/1.1\r\n\r\n", "osm.pbf").status == 405);
+        REQUIRE(http_server::parse_request("GET /14/8580 HTTP/1.1\r\n\r\n", "osm.pbf").status == 404);
+        REQUIRE(http_server::parse_request("GET /14/8580/5640.osm HTTP/1.1\r\n\r\n", "osm.pbf").status == 404);
+        REQUIRE(http_server::parse_request("GET /1/2/0 HTTP/1.1\r\n\r\n", "osm.pbf").status == 404);
+        REQUIRE(http_server::parse_request("GET /14/a/5640 HTTP/1.1\r\n\r\n", "osm.pbf").status == 404);
+        REQUIRE(http_server::parse_request("garbage", "osm.pbf").status == 400);
+    }
+}
+
+TEST_CASE("Test content types") {
+    REQUIRE(std::string(http_server::content_type("osm")) == "application/xml");
+    REQUIRE(std::string(http_server::content_type("osm.pbf")) == "application/octet-stream");
+}
+
+TEST_CASE("Test temporary directories") {
+    std::string path = http_server::make_temp_directory();
+    REQUIRE(mkdir((path + "14").c_str(), 0700) == 0);
+    REQUIRE(mkdir((path + "14/8580").c_str(), 0700) == 0);
+    std::ofstream {path + "14/8580/5640.osm.pbf"} << "tile";
+    REQUIRE(http_server::remove_directory(path));
+    struct stat stat_result;
+    REQUIRE(stat(path.c_str(), &stat_result) == -1);
+}
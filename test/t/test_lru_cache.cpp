@@ -0,0 +1,69 @@
+/*
+ * test_lru_cache.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <string>
+#include <lru_cache.hpp>
+
+using cache_type = LruCache<int, std::string>;
+
+TEST_CASE("Test LRU cache bounded by bytes") {
+    // space for three entries of 100 bytes
+    cache_type cache {3 * (100 + cache_type::ENTRY_OVERHEAD)};
+    cache.insert(1, "one", 100);
+    cache.insert(2, "two", 100);
+    cache.insert(3, "three", 100);
+
+    SECTION("look up entries") {
+        REQUIRE(cache.size() == 3);
+        REQUIRE(cache.bytes() == 3 * (100 + cache_type::ENTRY_OVERHEAD));
+        REQUIRE(*cache.find(2) == "two");
+        REQUIRE(cache.find(4) == nullptr);
+    }
+
+    SECTION("evict least recently inserted entry") {
+        cache.insert(4, "four", 100);
+        REQUIRE(cache.size() == 3);
+        REQUIRE(cache.find(1) == nullptr);
+        REQUIRE(*cache.find(4) == "four");
+    }
+
+    SECTION("evict least recently used entry") {
+        REQUIRE(cache.find(1) != nullptr);
+        cache.insert(4, "four", 100);
+        REQUIRE(*cache.find(1) == "one");
+        REQUIRE(cache.find(2) == nullptr);
+    }
+
+    SECTION("evict multiple entries for a large entry") {
+        cache.insert(4, "four", 200 + cache_type::ENTRY_OVERHEAD);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(*cache.find(3) == "three");
+        REQUIRE(*cache.find(4) == "four");
+    }
+
+    SECTION("replace entry") {
+        cache.insert(2, "zwei", 50);
+        REQUIRE(cache.size() == 3);
+        REQUIRE(*cache.find(2) == "zwei");
+        REQUIRE(cache.bytes() == 250 + 3 * cache_type::ENTRY_OVERHEAD);
+    }
+
+    SECTION("erase entry") {
+        cache.erase(2);
+        cache.erase(4);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.find(2) == nullptr);
+        REQUIRE(cache.bytes() == 2 * (100 + cache_type::ENTRY_OVERHEAD));
+    }
+
+    SECTION("entries larger than the cache are not inserted") {
+        cache.insert(5, "five", 1000);
+        REQUIRE(cache.find(5) == nullptr);
+        REQUIRE(cache.size() == 3);
+    }
+}
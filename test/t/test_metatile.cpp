@@ -0,0 +1,81 @@
+/*
+ * test_metatile.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <metatile.hpp>
+
+TEST_CASE("Test grouping of tiles into metatiles") {
+
+    SECTION("neighbouring tiles of the same block") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}, {8581, 5640, 14}, {8580, 5641, 14}};
+        std::vector<Metatile> metatiles = Metatile::group(tiles, 2);
+        REQUIRE(metatiles.size() == 1);
+        REQUIRE(metatiles[0].tiles().size() == 3);
+        REQUIRE(metatiles[0].tiles()[1].m_x == 8581);
+        REQUIRE(metatiles[0].bbox().m_min_lon == tiles[0].m_min_lon);
+        REQUIRE(metatiles[0].bbox().m_max_lon == tiles[1].m_max_lon);
+        REQUIRE(metatiles[0].bbox().m_max_lat == tiles[0].m_max_lat);
+        REQUIRE(metatiles[0].bbox().m_min_lat == tiles[2].m_min_lat);
+    }
+
+    SECTION("tiles of different blocks and zoom levels") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}, {8582, 5640, 14}, {4290, 2820, 13}, {8581, 5641, 14}};
+        std::vector<Metatile> metatiles = Metatile::group(tiles, 2);
+        REQUIRE(metatiles.size() == 3);
+        REQUIRE(metatiles[0].tiles().size() == 2);
+        REQUIRE(metatiles[0].tiles()[1].m_y == 5641);
+        REQUIRE(metatiles[1].tiles().size() == 1);
+        REQUIRE(metatiles[1].tiles()[0].m_x == 8582);
+        REQUIRE(metatiles[2].tiles()[0].m_zoom == 13);
+    }
+
+    SECTION("duplicate tiles") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}, {8580, 5640, 14}};
+        std::vector<Metatile> metatiles = Metatile::group(tiles, 2);
+        REQUIRE(metatiles.size() == 1);
+        REQUIRE(metatiles[0].tiles().size() == 1);
+    }
+
+    SECTION("invalid size") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}};
+        REQUIRE_THROWS(Metatile::group(tiles, 9));
+        REQUIRE_THROWS(Metatile::group(tiles, 0));
+    }
+}
+
+TEST_CASE("Test grouping of tiles into pyramids") {
+
+    SECTION("tiles below a tile of a lower zoom level") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}, {2145, 1410, 12}, {4290, 2820, 13}, {8000, 5000, 14}};
+        std::vector<Metatile> metatiles = Metatile::group_pyramids(tiles);
+        REQUIRE(metatiles.size() == 2);
+        REQUIRE(metatiles[0].tiles().size() == 3);
+        REQUIRE(metatiles[0].bbox().m_min_lon == tiles[1].m_min_lon);
+        REQUIRE(metatiles[0].bbox().m_max_lat == tiles[1].m_max_lat);
+        REQUIRE(metatiles[1].tiles()[0].m_x == 8000);
+    }
+
+    SECTION("intermediate zoom levels are optional") {
+        std::vector<BoundingBox> tiles {{8580, 5640, 14}, {536, 352, 10}};
+        std::vector<Metatile> metatiles = Metatile::group_pyramids(tiles);
+        REQUIRE(metatiles.size() == 1);
+        REQUIRE(metatiles[0].tiles().size() == 2);
+    }
+
+    SECTION("large pyramids are split") {
+        std::vector<BoundingBox> tiles {{0, 0, 4}};
+        for (int x = 0; x < 16; ++x) {
+            for (int y = 0; y < 16; ++y) {
+                tiles.emplace_back(x, y, 8);
+            }
+        }
+        std::vector<Metatile> metatiles = Metatile::group_pyramids(tiles);
+        REQUIRE(metatiles.size() == 5);
+        REQUIRE(metatiles[0].tiles().size() == Metatile::MAX_TILES);
+        REQUIRE(metatiles[4].tiles().size() == 1);
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * test_relation_closure.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <algorithm>
+#include <map>
+#include <input/relation_closure.hpp>
+
+namespace {
+
+    using id_vector = std::vector<osmium::object_id_type>;
+
+    /**
+     * Relation graph which counts how often the members of each relation are looked up.
+     */
+    class RelationGraph {
+        std::multimap<osmium::object_id_type, osmium::object_id_type> m_members;
+
+    public:
+        std::map<osmium::object_id_type, int> lookups;
+
+        void add(const osmium::object_id_type relation, const osmium::object_id_type member) {
+            m_members.emplace(relation, member);
+        }
+
+        id_vector closure(const id_vector& ids, const int max_depth) {
+            id_vector result = input::relation_closure(ids, max_depth,
+                    [this](const id_vector& relations, id_vector& members) {
+                for (const osmium::object_id_type relation : relations) {
+                    ++lookups[relation];
+                    auto range = m_members.equal_range(relation);
+                    for (auto it = range.first; it != range.second; ++it) {
+                        members.push_back(it->second);
+                    }
+                }
+            });
+            std::sort(result.begin(), result.end());
+            return result;
+        }
+
+        bool each_looked_up_once() const {
+            return std::all_of(lookups.begin(), lookups.end(), [](const std::pair<const osmium::object_id_type, int>& l) {
+                return l.second == 1;
+            });
+        }
+    };
+
+} // anonymous namespace
+
+TEST_CASE("Test closure of nested relations") {
+    RelationGraph graph;
+
+    SECTION("diamond") {
+        // 1 has the members 2 and 3 which both have the member 4
+        graph.add(1, 2);
+        graph.add(1, 3);
+        graph.add(2, 4);
+        graph.add(3, 4);
+        graph.add(4, 5);
+        REQUIRE(graph.closure({1}, 0) == id_vector({1, 2, 3, 4, 5}));
+        REQUIRE(graph.each_looked_up_once());
+    }
+
+    SECTION("cycle") {
+        graph.add(1, 2);
+        graph.add(2, 3);
+        graph.add(3, 1);
+        graph.add(3, 2);
+        REQUIRE(graph.closure({1}, 0) == id_vector({1, 2, 3}));
+        REQUIRE(graph.each_looked_up_once());
+    }
+
+    SECTION("depth limit") {
+        graph.add(1, 2);
+        graph.add(2, 3);
+        graph.add(3, 4);
+        graph.add(1, 3);
+        REQUIRE(graph.closure({1}, 1) == id_vector({1, 2, 3}));
+        REQUIRE(graph.closure({1}, 2) == id_vector({1, 2, 3, 4}));
+    }
+
+    SECTION("duplicate and nested start relations") {
+        graph.add(1, 2);
+        REQUIRE(graph.closure({2, 1, 2}, 0) == id_vector({1, 2}));
+        REQUIRE(graph.each_looked_up_once());
+    }
+}
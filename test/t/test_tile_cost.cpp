@@ -0,0 +1,46 @@
+/*
+ * test_tile_cost.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <stdexcept>
+#include <tile_cost.hpp>
+
+TEST_CASE("Test parsing cost estimates") {
+    REQUIRE(tile_cost::parse("zoom") == CostEstimate::ZOOM);
+    REQUIRE(tile_cost::parse("explain") == CostEstimate::EXPLAIN);
+    REQUIRE(tile_cost::parse("previous") == CostEstimate::PREVIOUS);
+    REQUIRE_THROWS_AS(tile_cost::parse("rows"), std::runtime_error&);
+}
+
+TEST_CASE("Test zoom cost") {
+    REQUIRE(tile_cost::zoom_cost(14, 14) == 1);
+    REQUIRE(tile_cost::zoom_cost(13, 14) == 4);
+    REQUIRE(tile_cost::zoom_cost(0, 2) == 16);
+    REQUIRE(tile_cost::zoom_cost(0, 29) == 288230376151711744.0);
+}
+
+TEST_CASE("Test row estimates of query plans") {
+    REQUIRE(tile_cost::plan_rows("Seq Scan on planet_osm_point  (cost=0.00..35.50 rows=2550 width=4)") == 2550);
+    REQUIRE(tile_cost::plan_rows("Bitmap Heap Scan on planet_osm_line  (cost=4.30..12.34 rows=1 width=40)") == 1);
+    REQUIRE_THROWS_AS(tile_cost::plan_rows("Result  (cost=0.00..0.01)"), std::runtime_error&);
+    REQUIRE_THROWS_AS(tile_cost::plan_rows("Result  (cost=0.00..0.01 rows=)"), std::runtime_error&);
+}
+
+TEST_CASE("Test rows recorded by --precheck") {
+    REQUIRE(tile_cost::recorded_rows("12/2026-10-16 10:00:00+00,3/,0/") == 15);
+    REQUIRE(tile_cost::recorded_rows("7/2026-10-16 10:00:00+00") == 7);
+    REQUIRE(tile_cost::recorded_rows("") < 0);
+    REQUIRE(tile_cost::recorded_rows("12,3") < 0);
+    REQUIRE(tile_cost::recorded_rows("abc/") < 0);
+}
+
+TEST_CASE("Test longest first order") {
+    std::vector<double> costs {1, 5, 3, 5, 0};
+    std::vector<size_t> expected {1, 3, 2, 0, 4};
+    REQUIRE(tile_cost::longest_first(costs) == expected);
+    REQUIRE(tile_cost::longest_first({}).empty());
+}
@@ -0,0 +1,112 @@
+/*
+ * test_tile_list.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <string.h>
+#include <tile_list.hpp>
+
+namespace {
+
+    void parse(TileList& tiles, const char* input) {
+        tiles.parse(input, input + strlen(input));
+    }
+
+} // namespace
+
+TEST_CASE("Test parsing of tile lists") {
+    TileList tiles;
+
+    SECTION("duplicates are dropped") {
+        parse(tiles, "14/8580/5640\n14/8581/5640\r\n\n14/8580/5640\n  13/4290/2820 \n14/8581/5640");
+        REQUIRE(tiles.tiles_read() == 5);
+        REQUIRE(tiles.size() == 3);
+        std::vector<BoundingBox> bboxes = tiles.bboxes();
+        REQUIRE(bboxes[0].m_x == 8580);
+        REQUIRE(bboxes[1].m_x == 8581);
+        REQUIRE(bboxes[2].m_zoom == 13);
+    }
+
+    SECTION("clear") {
+        parse(tiles, "14/8580/5640\n");
+        tiles.clear();
+        REQUIRE(tiles.size() == 0);
+        parse(tiles, "14/8580/5640\n");
+        REQUIRE(tiles.tiles_read() == 1);
+        REQUIRE(tiles.size() == 1);
+    }
+
+    SECTION("empty input") {
+        parse(tiles, "");
+        REQUIRE(tiles.size() == 0);
+    }
+
+    SECTION("invalid lines") {
+        REQUIRE_THROWS(parse(tiles, "14/8580/5640\n14/8580\n"));
+        REQUIRE_THROWS(parse(tiles, "14/8580/5640x\n"));
+        REQUIRE_THROWS(parse(tiles, "1/2/0\n"));
+        REQUIRE_THROWS(parse(tiles, "30/0/0\n"));
+    }
+}
+
+TEST_CASE("Test expanding and collapsing of tile lists") {
+    TileList tiles;
+
+    SECTION("expand to lower zoom levels") {
+        tiles.set_zoom_range(12, 14);
+        parse(tiles, "14/8580/5640\n14/8581/5641\n");
+        REQUIRE(tiles.tiles_read() == 2);
+        REQUIRE(tiles.size() == 4);
+        std::vector<BoundingBox> bboxes = tiles.bboxes();
+        REQUIRE(bboxes[0].m_zoom == 12);
+        REQUIRE(bboxes[0].m_x == 2145);
+        REQUIRE(bboxes[0].m_y == 1410);
+        REQUIRE(bboxes[1].m_zoom == 13);
+        REQUIRE(bboxes[2].m_zoom == 14);
+        REQUIRE(bboxes[3].m_x == 8581);
+    }
+
+    SECTION("expand to higher zoom levels") {
+        tiles.set_zoom_range(14, 15);
+        parse(tiles, "13/4290/2820\n");
+        REQUIRE(tiles.size() == 20);
+    }
+
+    SECTION("expansion depth is limited") {
+        tiles.set_zoom_range(0, 10);
+        parse(tiles, "2/1/1\n");
+        REQUIRE(tiles.size() == 3 + 4 + 16 + 64 + 256 + 1024 + 4096 + 16384 + 65536);
+        REQUIRE_THROWS(parse(tiles, "1/1/1\n"));
+    }
+
+    SECTION("collapse") {
+        tiles.set_collapse_zoom(13);
+        parse(tiles, "14/8580/5640\n14/8581/5641\n12/2145/1410\n");
+        REQUIRE(tiles.size() == 2);
+        std::vector<BoundingBox> bboxes = tiles.bboxes();
+        REQUIRE(bboxes[0].m_zoom == 13);
+        REQUIRE(bboxes[0].m_x == 4290);
+        REQUIRE(bboxes[1].m_zoom == 12);
+    }
+
+    SECTION("invalid zoom range") {
+        REQUIRE_THROWS(tiles.set_zoom_range(14, 12));
+        REQUIRE_THROWS(tiles.set_zoom_range(0, 30));
+    }
+}
+
+TEST_CASE("Test parsing of zoom ranges") {
+    int min_zoom = -1;
+    int max_zoom = -1;
+    TileList::parse_zoom_range("10-14", min_zoom, max_zoom);
+    REQUIRE(min_zoom == 10);
+    REQUIRE(max_zoom == 14);
+    TileList::parse_zoom_range("12", min_zoom, max_zoom);
+    REQUIRE(min_zoom == 12);
+    REQUIRE(max_zoom == 12);
+    REQUIRE_THROWS(TileList::parse_zoom_range("10-", min_zoom, max_zoom));
+    REQUIRE_THROWS(TileList::parse_zoom_range("a", min_zoom, max_zoom));
+}
@@ -0,0 +1,83 @@
+/*
+ * test_tile_order.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <bounding_box.hpp>
+#include <tile_order.hpp>
+
+TEST_CASE("Test parsing of tile orders") {
+    REQUIRE(tile_order::parse("none") == TileOrder::NONE);
+    REQUIRE(tile_order::parse("quadtree") == TileOrder::QUADTREE);
+    REQUIRE(tile_order::parse("hilbert") == TileOrder::HILBERT);
+    REQUIRE_THROWS(tile_order::parse("zorder"));
+}
+
+TEST_CASE("Test Hilbert curve") {
+
+    SECTION("first order curve") {
+        REQUIRE(tile_order::hilbert_index(0, 0, 1) == 0);
+        REQUIRE(tile_order::hilbert_index(0, 1, 1) == 1);
+        REQUIRE(tile_order::hilbert_index(1, 1, 1) == 2);
+        REQUIRE(tile_order::hilbert_index(1, 0, 1) == 3);
+    }
+
+    SECTION("consecutive positions are neighbours") {
+        const int zoom = 4;
+        const uint32_t count = 1 << zoom;
+        std::vector<std::pair<uint32_t, uint32_t>> positions(count * count);
+        for (uint32_t x = 0; x < count; ++x) {
+            for (uint32_t y = 0; y < count; ++y) {
+                positions.at(tile_order::hilbert_index(x, y, zoom)) = std::make_pair(x, y);
+            }
+        }
+        for (size_t i = 1; i < positions.size(); ++i) {
+            int dx = static_cast<int>(positions[i].first) - static_cast<int>(positions[i - 1].first);
+            int dy = static_cast<int>(positions[i].second) - static_cast<int>(positions[i - 1].second);
+            REQUIRE(std::abs(dx) + std::abs(dy) == 1);
+        }
+    }
+}
+
+TEST_CASE("Test sorting of tiles") {
+    std::vector<BoundingBox> tiles {{8581, 5641, 14}, {8580, 5640, 14}, {4290, 2820, 13}, {8581, 5640, 14},
+        {8580, 5641, 14}, {0, 0, 14}};
+
+    SECTION("no order") {
+        tile_order::sort(tiles, TileOrder::NONE);
+        REQUIRE(tiles[0].m_x == 8581);
+        REQUIRE(tiles[5].m_x == 0);
+    }
+
+    SECTION("quadtree order") {
+        tile_order::sort(tiles, TileOrder::QUADTREE);
+        REQUIRE(tiles.size() == 6);
+        REQUIRE(tiles[0].m_x == 0);
+        REQUIRE(tiles[1].m_zoom == 13);
+        REQUIRE(tiles[2].m_x == 8580);
+        REQUIRE(tiles[2].m_y == 5640);
+        REQUIRE(tiles[3].m_x == 8581);
+        REQUIRE(tiles[3].m_y == 5640);
+        REQUIRE(tiles[4].m_x == 8580);
+        REQUIRE(tiles[4].m_y == 5641);
+        REQUIRE(tiles[5].m_x == 8581);
+        REQUIRE(tiles[5].m_y == 5641);
+    }
+
+    SECTION("Hilbert order keeps children after their parent") {
+        tile_order::sort(tiles, TileOrder::HILBERT);
+        REQUIRE(tiles.size() == 6);
+        size_t parent = 0;
+        while (tiles[parent].m_zoom != 13) {
+            ++parent;
+        }
+        REQUIRE(parent + 5 <= tiles.size());
+        for (size_t i = parent + 1; i < parent + 5; ++i) {
+            REQUIRE(tiles[i].m_x / 2 == 4290);
+            REQUIRE(tiles[i].m_y / 2 == 2820);
+        }
+    }
+}
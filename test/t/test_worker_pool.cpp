@@ -0,0 +1,71 @@
+/*
+ * test_worker_pool.cpp
+ *
+ *  Created on:  2026-10-16
+ *      Author: Michael Reichert
+ */
+
+#include "catch.hpp"
+#include <chrono>
+#include <input/column_config_parser.hpp>
+#include <worker_pool.hpp>
+
+namespace {
+
+    /**
+     * Worker reporting a constant latency for each tile like the data access of a TileWorker
+     * reports the latency of each spatial query.
+     */
+    class FakeWorker {
+        ConcurrencyController* m_controller;
+
+    public:
+        FakeWorker(VectortileGeneratorConfig&, input::ColumnConfigParser&, std::mutex&,
+                ConcurrencyController* controller) :
+            m_controller(controller) {
+        }
+
+        void create_tile(const BoundingBox&) {
+            if (m_controller) {
+                m_controller->record(std::chrono::milliseconds(1));
+            }
+        }
+
+        void create_metatile(const Metatile& metatile) {
+            for (const BoundingBox& bbox : metatile.tiles()) {
+                create_tile(bbox);
+            }
+        }
+
+        double estimate_cost(const BoundingBox& bbox) {
+            return bbox.m_x;
+        }
+
+        void flush_jobs() {
+        }
+    };
+
+} // anonymous namespace
+
+TEST_CASE("Test adaptive concurrency of workers") {
+    VectortileGeneratorConfig config;
+    input::ColumnConfigParser column_parser {config};
+    std::mutex output_mutex;
+    ConcurrencyController controller {4, 2.0};
+    std::vector<std::unique_ptr<FakeWorker>> workers(4);
+    std::vector<BoundingBox> bboxes;
+    for (int x = 0; x < 200; ++x) {
+        bboxes.emplace_back(x, 0, 14);
+    }
+
+    SECTION("without cost estimate") {
+        create_tiles(config, column_parser, workers, &controller, bboxes, output_mutex);
+        REQUIRE(controller.limit() > 1);
+    }
+
+    SECTION("workers created while estimating costs report latencies") {
+        config.m_cost_estimate = CostEstimate::EXPLAIN;
+        create_tiles(config, column_parser, workers, &controller, bboxes, output_mutex);
+        REQUIRE(controller.limit() > 1);
+    }
+}